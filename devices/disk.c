@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -71,7 +72,8 @@ struct channel {
 	struct lock lock;           /* Must acquire to access the controller. */
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
-	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+	struct semaphore completion_wait;   /* Up'd by completion_work. */
+	struct work completion_work;        /* Scheduled by interrupt handler. */
 
 	struct disk devices[2];     /* The devices on this channel. */
 };
@@ -95,6 +97,7 @@ static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static work_func complete_command;
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -122,6 +125,7 @@ disk_init (void) {
 		lock_init (&c->lock);
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		work_init (&c->completion_work, complete_command, c);
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -511,7 +515,8 @@ select_device_wait (const struct disk *d) {
 	wait_until_idle (d);
 }
 
-/* ATA interrupt handler. */
+/* ATA interrupt handler.  Acknowledges the interrupt and leaves
+   waking the waiter to complete_command(). */
 static void
 interrupt_handler (struct intr_frame *f) {
 	struct channel *c;
@@ -520,7 +525,7 @@ interrupt_handler (struct intr_frame *f) {
 		if (f->vec_no == c->irq) {
 			if (c->expecting_interrupt) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
-				sema_up (&c->completion_wait);      /* Wake up waiter. */
+				work_schedule (&c->completion_work, WORK_HIGH);
 			} else
 				printf ("%s: unexpected interrupt\n", c->name);
 			return;
@@ -529,6 +534,15 @@ interrupt_handler (struct intr_frame *f) {
 	NOT_REACHED ();
 }
 
+/* Wakes up the thread waiting for the command that channel C_
+   just completed.  Runs as deferred work. */
+static void
+complete_command (void *c_) {
+	struct channel *c = c_;
+
+	sema_up (&c->completion_wait);
+}
+
 static void
 inspect_read_cnt (struct intr_frame *f) {
 	struct disk * d = disk_get (f->R.rdx, f->R.rcx);
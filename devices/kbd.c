@@ -6,6 +6,7 @@
 #include "devices/input.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/workqueue.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -23,11 +24,22 @@ static bool caps_lock;
 /* Number of keys pressed. */
 static int64_t key_cnt;
 
+/* Scancodes read by the interrupt handler and not yet
+   translated.  The interrupt handler only reads the scancode;
+   translating it into a character is deferred to kbd_work. */
+#define SCANCODE_BUF_SIZE 64
+static uint16_t scancodes[SCANCODE_BUF_SIZE];
+static size_t scancode_head, scancode_tail;
+static struct work kbd_work;
+
 static intr_handler_func keyboard_interrupt;
+static work_func translate_scancodes;
+static void translate_scancode (unsigned code);
 
 /* Initializes the keyboard. */
 void
 kbd_init (void) {
+	work_init (&kbd_work, translate_scancodes, NULL);
 	intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
 }
 
@@ -84,27 +96,57 @@ static const struct keymap shifted_keymap[] = {
 
 static bool map_key (const struct keymap[], unsigned scancode, uint8_t *);
 
+/* Keyboard interrupt handler: reads the scancode and leaves the
+   rest to translate_scancodes(). */
 static void
 keyboard_interrupt (struct intr_frame *args UNUSED) {
+	unsigned code;
+
+	/* Read scancode, including second byte if prefix code. */
+	code = inb (DATA_REG);
+	if (code == 0xe0)
+		code = (code << 8) | inb (DATA_REG);
+
+	/* Drop the key if the buffer is full, as when the input
+	   buffer is full. */
+	if (scancode_head - scancode_tail < SCANCODE_BUF_SIZE)
+		scancodes[scancode_head++ % SCANCODE_BUF_SIZE] = code;
+	work_schedule (&kbd_work, WORK_HIGH);
+}
+
+/* Translates the buffered scancodes.  Runs as deferred work. */
+static void
+translate_scancodes (void *aux UNUSED) {
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		unsigned code;
+
+		if (scancode_tail == scancode_head) {
+			intr_set_level (old_level);
+			break;
+		}
+		code = scancodes[scancode_tail++ % SCANCODE_BUF_SIZE];
+		intr_set_level (old_level);
+
+		translate_scancode (code);
+	}
+}
+
+/* Updates the shift state for CODE, or adds its character to the
+   input buffer. */
+static void
+translate_scancode (unsigned code) {
 	/* Status of shift keys. */
 	bool shift = left_shift || right_shift;
 	bool alt = left_alt || right_alt;
 	bool ctrl = left_ctrl || right_ctrl;
 
-	/* Keyboard scancode. */
-	unsigned code;
-
 	/* False if key pressed, true if key released. */
 	bool release;
 
 	/* Character that corresponds to `code'. */
 	uint8_t c;
 
-	/* Read scancode, including second byte if prefix code. */
-	code = inb (DATA_REG);
-	if (code == 0xe0)
-		code = (code << 8) | inb (DATA_REG);
-
 	/* Bit 0x80 distinguishes key press from key release
 	   (even if there's a prefix). */
 	release = (code & 0x80) != 0;
@@ -135,10 +177,12 @@ keyboard_interrupt (struct intr_frame *args UNUSED) {
 				c += 0x80;
 
 			/* Append to keyboard buffer. */
+			enum intr_level old_level = intr_disable ();
 			if (!input_full ()) {
 				key_cnt++;
 				input_putc (c);
 			}
+			intr_set_level (old_level);
 		}
 	} else {
 		/* Maps a keycode into a shift state variable. */
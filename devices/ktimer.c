@@ -0,0 +1,251 @@
+#include "devices/ktimer.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+
+/* Hierarchical timing wheel.
+
+   The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots each.
+   Level 0 has one slot per tick and covers the next WHEEL_SLOTS
+   ticks.  Each slot of level N covers WHEEL_SLOTS times as many
+   ticks as a slot of level N-1, so the four levels together
+   cover 2**24 ticks (about 46 hours at 100 Hz).  A timer that
+   expires further out than that is parked in the last slot
+   that can hold it and is re-filed when that slot comes due.
+
+   A timer is filed in the slot for its expiry tick at the lowest
+   level whose span reaches that tick, which is O(1).  Whenever
+   level N-1 wraps around, the next slot of level N is "cascaded":
+   its timers are re-filed one level down.  Each timer is
+   cascaded at most WHEEL_LEVELS - 1 times, so expiry is O(1)
+   amortized as well.
+
+   This is the scheme described in [Varghese87] and used by the
+   classic Linux timer wheel. */
+
+#define WHEEL_BITS 6                        /* Bits of tick per level. */
+#define WHEEL_SLOTS (1 << WHEEL_BITS)       /* Slots per level. */
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4                      /* Number of levels. */
+#define WHEEL_SPAN (1ll << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+/* Next tick the wheel will process.  Every pending timer expires
+   at or after this tick or sits in the level-0 slot for it. */
+static int64_t wheel_clk;
+
+/* Statistics. */
+static long long timers_added;      /* # of ktimer_add() calls. */
+static long long timers_fired;      /* # of callbacks run. */
+static long long timers_cascaded;   /* # of times a timer moved down. */
+static long long timers_pending;    /* # of timers now in the wheel. */
+
+static void enqueue (struct ktimer *);
+static void cascade (int level);
+
+/* Initializes the timing wheel to start processing at tick NOW. */
+void
+ktimer_wheel_init (int64_t now) {
+	int level, slot;
+
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		for (slot = 0; slot < WHEEL_SLOTS; slot++)
+			list_init (&wheel[level][slot]);
+	wheel_clk = now;
+}
+
+/* Initializes T as an inactive timer that will call FUNC with
+   AUX once added. */
+void
+ktimer_init (struct ktimer *t, ktimer_func *func, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (func != NULL);
+
+	t->func = func;
+	t->aux = aux;
+	t->expires = 0;
+	t->pending = false;
+}
+
+/* Arms T, which must not be pending, to run its callback at timer
+   tick EXPIRES.  If EXPIRES has already passed, the callback runs
+   on the next timer tick. */
+void
+ktimer_add (struct ktimer *t, int64_t expires) {
+	enum intr_level old_level;
+
+	ASSERT (t != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (!t->pending);
+	t->expires = expires;
+	t->pending = true;
+	enqueue (t);
+	timers_added++;
+	timers_pending++;
+	intr_set_level (old_level);
+}
+
+/* Re-arms T to run its callback at tick EXPIRES, whether or not
+   it is pending.  Returns true if T was pending, false
+   otherwise. */
+bool
+ktimer_mod (struct ktimer *t, int64_t expires) {
+	enum intr_level old_level;
+	bool was_pending;
+
+	ASSERT (t != NULL);
+
+	old_level = intr_disable ();
+	was_pending = ktimer_cancel (t);
+	ktimer_add (t, expires);
+	intr_set_level (old_level);
+
+	return was_pending;
+}
+
+/* Disarms T.  Returns true if T was pending, false if it had
+   already run or was never added. */
+bool
+ktimer_cancel (struct ktimer *t) {
+	enum intr_level old_level;
+	bool was_pending;
+
+	ASSERT (t != NULL);
+
+	old_level = intr_disable ();
+	was_pending = t->pending;
+	if (was_pending) {
+		list_remove (&t->elem);
+		t->pending = false;
+		timers_pending--;
+	}
+	intr_set_level (old_level);
+
+	return was_pending;
+}
+
+/* Returns true if T is armed and has not run yet. */
+bool
+ktimer_pending (const struct ktimer *t) {
+	ASSERT (t != NULL);
+
+	return t->pending;
+}
+
+/* Advances the wheel through tick NOW, running the callbacks of
+   all timers that expire on or before NOW.  Called from the timer
+   interrupt handler. */
+void
+ktimer_run (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (wheel_clk <= now) {
+		int slot = wheel_clk & WHEEL_MASK;
+		struct list expired;
+
+		/* When a level wraps, refill it from the level above. */
+		if (slot == 0) {
+			int level;
+
+			for (level = 1; level < WHEEL_LEVELS; level++) {
+				int idx = (wheel_clk >> (level * WHEEL_BITS)) & WHEEL_MASK;
+				cascade (level);
+				if (idx != 0)
+					break;
+			}
+		}
+
+		/* Take the whole slot first, so that a callback that
+		   re-arms a timer for this tick cannot make us loop. */
+		list_init (&expired);
+		if (!list_empty (&wheel[0][slot]))
+			list_splice (list_end (&expired),
+					list_begin (&wheel[0][slot]), list_end (&wheel[0][slot]));
+		wheel_clk++;
+
+		while (!list_empty (&expired)) {
+			struct ktimer *t = list_entry (list_pop_front (&expired),
+					struct ktimer, elem);
+			t->pending = false;
+			timers_pending--;
+			timers_fired++;
+			t->func (t->aux);
+		}
+	}
+}
+
+/* Returns a tick no later than the earliest expiry among the
+   pending timers, or INT64_MAX if there are none.  Timers in the
+   upper levels are not examined: they all expire at or after the
+   next tick at which level 0 wraps around and they are cascaded,
+   so that tick is returned if level 0 has nothing sooner. */
+int64_t
+ktimer_next_expiry (void) {
+	int64_t wrap = (wheel_clk + WHEEL_MASK) & ~(int64_t) WHEEL_MASK;
+	int64_t tick;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (timers_pending == 0)
+		return INT64_MAX;
+	for (tick = wheel_clk; tick < wrap; tick++)
+		if (!list_empty (&wheel[0][tick & WHEEL_MASK]))
+			return tick;
+	return wrap;
+}
+
+/* Prints kernel timer statistics. */
+void
+ktimer_print_stats (void) {
+	printf ("Ktimer: %lld added, %lld fired, %lld cascaded, %lld pending\n",
+			timers_added, timers_fired, timers_cascaded, timers_pending);
+}
+
+/* Files pending timer T in the wheel slot that covers its expiry
+   tick. */
+static void
+enqueue (struct ktimer *t) {
+	int64_t expires = t->expires;
+	int64_t delta = expires - wheel_clk;
+	int level;
+
+	if (delta < 0) {
+		/* Already due: run it on the next tick processed. */
+		expires = wheel_clk;
+		delta = 0;
+	} else if (delta >= WHEEL_SPAN) {
+		/* Too far out: park it in the last slot that reaches. */
+		expires = wheel_clk + WHEEL_SPAN - 1;
+		delta = WHEEL_SPAN - 1;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < 1ll << ((level + 1) * WHEEL_BITS))
+			break;
+
+	list_push_back (&wheel[level][(expires >> (level * WHEEL_BITS))
+			& WHEEL_MASK], &t->elem);
+}
+
+/* Re-files the timers in the slot of LEVEL that wheel_clk has just
+   reached into lower levels. */
+static void
+cascade (int level) {
+	struct list *slot =
+		&wheel[level][(wheel_clk >> (level * WHEEL_BITS)) & WHEEL_MASK];
+	struct list moving;
+
+	list_init (&moving);
+	if (list_empty (slot))
+		return;
+	list_splice (list_end (&moving), list_begin (slot), list_end (slot));
+
+	while (!list_empty (&moving)) {
+		struct ktimer *t = list_entry (list_pop_front (&moving),
+				struct ktimer, elem);
+		enqueue (t);
+		timers_cascaded++;
+	}
+}
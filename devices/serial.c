@@ -7,6 +7,7 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 
 /* Register definitions for the 16550A UART used in PCs.
    The 16550A has a lot more going on than shown here, but this
@@ -54,10 +55,23 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Bytes received by the interrupt handler and not yet passed to
+   the input buffer.  The interrupt handler only empties the
+   UART's receive register into this ring; passing the bytes on,
+   which may wake a reader, is deferred to recv_work.  Transmit
+   stays in the interrupt handler: it is one port write per
+   interrupt, and console output must not depend on a worker
+   thread that may itself be printing. */
+#define RECV_BUF_SIZE 64
+static uint8_t recv_buf[RECV_BUF_SIZE];
+static size_t recv_head, recv_tail;
+static struct work recv_work;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
+static work_func deliver_received;
 
 /* Initializes the serial port device for polling mode.
    Polling mode busy-waits for the serial port to become free
@@ -85,6 +99,7 @@ serial_init_queue (void) {
 		init_poll ();
 	ASSERT (mode == POLL);
 
+	work_init (&recv_work, deliver_received, NULL);
 	intr_register_ext (0x20 + 4, serial_interrupt, "serial");
 	mode = QUEUE;
 	old_level = intr_disable ();
@@ -133,14 +148,18 @@ serial_flush (void) {
 }
 
 /* The fullness of the input buffer may have changed.  Reassess
-   whether we should block receive interrupts.
+   whether we should block receive interrupts, and pass on any
+   received bytes that were waiting for room.
    Called by the input buffer routines when characters are added
    to or removed from the buffer. */
 void
 serial_notify (void) {
 	ASSERT (intr_get_level () == INTR_OFF);
-	if (mode == QUEUE)
+	if (mode == QUEUE) {
+		if (recv_head != recv_tail && !input_full ())
+			work_schedule (&recv_work, WORK_HIGH);
 		write_ier ();
+	}
 }
 
 /* Configures the serial port for BPS bits per second. */
@@ -176,7 +195,7 @@ write_ier (void) {
 
 	/* Enable receive interrupt if we have room to store any
 	   characters we receive. */
-	if (!input_full ())
+	if (recv_head - recv_tail < RECV_BUF_SIZE)
 		ier |= IER_RECV;
 
 	outb (IER_REG, ier);
@@ -202,8 +221,11 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 
 	/* As long as we have room to receive a byte, and the hardware
 	   has a byte for us, receive a byte.  */
-	while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
-		input_putc (inb (RBR_REG));
+	while (recv_head - recv_tail < RECV_BUF_SIZE
+			&& (inb (LSR_REG) & LSR_DR) != 0)
+		recv_buf[recv_head++ % RECV_BUF_SIZE] = inb (RBR_REG);
+	if (recv_head != recv_tail)
+		work_schedule (&recv_work, WORK_HIGH);
 
 	/* As long as we have a byte to transmit, and the hardware is
 	   ready to accept a byte for transmission, transmit a byte. */
@@ -213,3 +235,15 @@ serial_interrupt (struct intr_frame *f UNUSED) {
 	/* Update interrupt enable register based on queue status. */
 	write_ier ();
 }
+
+/* Passes the bytes that serial_interrupt() received on to the
+   input buffer, as far as it has room.  Runs as deferred work. */
+static void
+deliver_received (void *aux UNUSED) {
+	enum intr_level old_level = intr_disable ();
+
+	while (recv_head != recv_tail && !input_full ())
+		input_putc (recv_buf[recv_tail++ % RECV_BUF_SIZE]);
+	write_ier ();
+	intr_set_level (old_level);
+}
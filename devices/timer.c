@@ -1,12 +1,17 @@
 #include "devices/timer.h"
 #include <debug.h>
+#include <heap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/ktimer.h"
+#include "threads/apic.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -17,66 +22,173 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  Written only by the
+   timer interrupt, under ticks_seq. */
 static int64_t ticks;
+static struct seqlock ticks_seq;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* Drive timer ticks from the local APIC timer instead of the
+   8254?  Set by the "-lapic-timer" kernel command line option. */
+bool timer_use_lapic;
+static bool lapic_clock;            /* Is it in fact driving them? */
+
+/* 8254 input frequency, and that divided by TIMER_FREQ, rounded
+   to nearest: the 8254 count for one tick. */
+#define PIT_HZ 1193180
+#define PIT_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Tickless idle.  Set by the "-nohz" kernel command line option.
+
+   Normally the timer interrupts every tick, even when there is
+   nothing to do but halt.  With -nohz, the idle thread calls
+   timer_idle_enter() before halting, which switches the clock to
+   one-shot mode, set to interrupt only at the next tick at which
+   a sleeping thread or a kernel timer is due.
+
+   The interrupt that ends the idle period, whether the timer's
+   own or another device's, calls timer_irq_enter() on entry.
+   That works out from the TSC how many ticks went by while the
+   tick was stopped and runs each of them, so that `ticks' is
+   right before any handler looks at it.  Then it sets the clock
+   to interrupt once more at the next tick boundary, where it
+   goes back to periodic mode. */
+bool timer_nohz;
+
+enum tick_mode {
+	TICK_PERIODIC,                  /* Interrupting every tick. */
+	TICK_STOPPED,                   /* Idle, one-shot to next event. */
+	TICK_RESYNC                     /* One-shot to next tick boundary. */
+};
+static enum tick_mode tick_mode;
+static uint64_t tsc_per_tick;       /* TSC cycles per tick. */
+static uint64_t tick_tsc;           /* TSC at the last tick. */
+
+/* Most ticks to stop the tick for at once. */
+#define NOHZ_MAX_TICKS TIMER_FREQ
+
+/* Tickless idle statistics. */
+static long long nohz_cnt;          /* # of times the tick was stopped. */
+static long long nohz_ticks;        /* # of ticks that went by stopped. */
+
+/* TSC clocksource, calibrated once by timer_init().  The TSC is
+   taken to tick at a constant rate, as the "invariant TSC" of any
+   recent x86-64 CPU does. */
+static uint64_t tsc_hz;             /* TSC cycles per second. */
+static uint64_t tsc_boot;           /* TSC at calibration: time 0. */
+static uint64_t ns_mult;            /* Nanoseconds per cycle * 2**32. */
+
+/* TSC calibration lasts 1/CALIBRATE_HZ s. */
+#define CALIBRATE_HZ 100
+
+/* Threads blocked in timer_sleep(), as a min-heap ordered by
+   wake-up tick.  The timer interrupt only looks at the top of
+   the heap, so a tick costs nothing per sleeping thread that is
+   not yet due. */
+static struct heap sleep_queue;
+
+/* Sleep queue statistics. */
+static long long sleep_cnt;         /* # of threads put to sleep. */
+static size_t sleep_queue_max;      /* Longest the sleep queue has been. */
+static long long wakeup_late_ticks; /* Total ticks from due to running. */
+static int64_t wakeup_late_max;     /* Worst ticks from due to running. */
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
+static intr_handler_func ap_timer_interrupt;
+static void do_tick (void);
+static int64_t tick_catch_up (void);
+static void clock_periodic (void);
+static void clock_oneshot (uint64_t cycles);
+static heap_less_func wakeup_less;
+static void calibrate_tsc (void);
 static void real_time_sleep (int64_t num, int32_t denom);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
-   corresponding interrupt. */
+   corresponding interrupt.  With -lapic-timer, the local APIC
+   timer raises the same interrupt instead and the 8254's IRQ is
+   masked, if the APIC is in use.  Also calibrates the TSC, and
+   registers the interrupt of the APs' local APIC timers. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	seqlock_init (&ticks_seq);
+	calibrate_tsc ();
+	clock_periodic ();
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	heap_init (&sleep_queue, wakeup_less, NULL);
+	ktimer_wheel_init (ticks);
+	if (timer_use_lapic && apic_timer_init (0x20, TIMER_FREQ)) {
+		apic_mask_irq (0, true);
+		lapic_clock = true;
+		intr_register_ext (0x20, timer_interrupt, "Local APIC Timer");
+	} else
+		intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+	intr_register_ext (LAPIC_TIMER_VEC, ap_timer_interrupt,
+			"AP Local APIC Timer");
+}
+
+/* Measures the TSC's rate against the 8254.  Channel 2, which
+   otherwise only drives the PC speaker, counts down
+   1/CALIBRATE_HZ s once in mode 0 while we watch its output,
+   without disturbing channel 0. */
+static void
+calibrate_tsc (void) {
+	uint16_t count = PIT_HZ / CALIBRATE_HZ;
+	uint64_t start;
 
-	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+	outb (0x61, (inb (0x61) & ~0x02) | 0x01);   /* Gate on, speaker off. */
+	outb (0x43, 0xb0);    /* CW: counter 2, LSB then MSB, mode 0, binary. */
+	outb (0x42, count & 0xff);
+	outb (0x42, count >> 8);
+	start = rdtsc ();
+	while ((inb (0x61) & 0x20) == 0)
+		continue;
+	tsc_boot = rdtsc ();
+
+	tsc_hz = (tsc_boot - start) * PIT_HZ / count;
+	ns_mult = ((uint64_t) NSEC_PER_SEC << 32) / tsc_hz;
+	tsc_per_tick = tsc_hz / TIMER_FREQ;
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
-void
-timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+/* Returns the TSC's rate, in cycles per second. */
+uint64_t
+timer_tsc_hz (void) {
+	return tsc_hz;
+}
 
-	ASSERT (intr_get_level () == INTR_ON);
-	printf ("Calibrating timer...  ");
-
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+/* Returns the number of nanoseconds since the TSC was
+   calibrated, early in boot. */
+uint64_t
+timer_ns (void) {
+	uint64_t cycles = rdtsc () - tsc_boot;
+
+	return ((unsigned __int128) cycles * ns_mult) >> 32;
+}
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+/* Stores the time on clock CLOCK in *TS.  Returns false if CLOCK
+   is not a supported clock.  Only CLOCK_MONOTONIC, the time since
+   boot, is supported: there is no real-time clock driver. */
+bool
+timer_gettime (clockid_t clock, struct timespec *ts) {
+	uint64_t ns;
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	if (clock != CLOCK_MONOTONIC)
+		return false;
+	ns = timer_ns ();
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+	return true;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) {
-	enum intr_level old_level = intr_disable ();
-	int64_t t = ticks;
-	intr_set_level (old_level);
-	barrier ();
+	unsigned seq;
+	int64_t t;
+
+	do {
+		seq = seqlock_read_begin (&ticks_seq);
+		t = ticks;
+	} while (seqlock_read_retry (&ticks_seq, seq));
 	return t;
 }
 
@@ -87,14 +199,34 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
-/* Suspends execution for approximately TICKS timer ticks. */
+/* Suspends execution for approximately TICKS timer ticks.
+   The thread blocks on the sleep queue and is unblocked by the
+   timer interrupt once TICKS ticks have elapsed. */
 void
 timer_sleep (int64_t ticks) {
-	int64_t start = timer_ticks ();
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+	int64_t late;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	while (timer_elapsed (start) < ticks)
-		thread_yield ();
+	if (ticks <= 0)
+		return;
+
+	old_level = intr_disable ();
+	t->wakeup_tick = timer_ticks () + ticks;
+	heap_push (&sleep_queue, &t->sleep_elem);
+	sleep_cnt++;
+	if (heap_size (&sleep_queue) > sleep_queue_max)
+		sleep_queue_max = heap_size (&sleep_queue);
+	thread_block ();
+
+	/* Account for how long we sat in the run queue after our
+	   wake-up tick. */
+	late = timer_ticks () - t->wakeup_tick;
+	wakeup_late_ticks += late;
+	if (late > wakeup_late_max)
+		wakeup_late_max = late;
+	intr_set_level (old_level);
 }
 
 /* Suspends execution for approximately MS milliseconds. */
@@ -118,69 +250,213 @@ timer_nsleep (int64_t ns) {
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
-	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	printf ("Timer: %"PRId64" ticks, TSC at %'"PRIu64" Hz\n",
+			timer_ticks (), tsc_hz);
+	printf ("Sleep: %lld sleeps, %zu max sleeping, "
+			"%lld ticks late (%"PRId64" max)\n",
+			sleep_cnt, sleep_queue_max, wakeup_late_ticks, wakeup_late_max);
+	ktimer_print_stats ();
+	if (timer_nohz)
+		printf ("Tickless: %lld idle periods, %lld ticks stopped\n",
+				nohz_cnt, nohz_ticks);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  With -nohz, stops the periodic tick until the next tick
+   at which a sleeping thread or a kernel timer is due.  Only the
+   BSP gets the tick, and it keeps it while APs are running,
+   since they may be busy while it is idle. */
+void
+timer_idle_enter (void) {
+	int64_t next, delta;
+	uint64_t now, when;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_nohz || tick_mode != TICK_PERIODIC || cpu_online_cnt > 1)
+		return;
+
+	next = ktimer_next_expiry ();
+	if (!heap_empty (&sleep_queue)) {
+		struct thread *t = heap_entry (heap_top (&sleep_queue),
+				struct thread, sleep_elem);
+		if (t->wakeup_tick < next)
+			next = t->wakeup_tick;
+	}
+	delta = next - ticks;
+	if (delta <= 1)
+		return;
+	if (delta > NOHZ_MAX_TICKS)
+		delta = NOHZ_MAX_TICKS;
+
+	now = rdtsc ();
+	when = tick_tsc + delta * tsc_per_tick;
+	if (when <= now)
+		return;
+	clock_oneshot (when - now);
+	tick_mode = TICK_STOPPED;
+	nohz_cnt++;
+}
+
+/* Called on entry to every external interrupt.  If the tick is
+   stopped, runs the ticks that went by, and restarts it at the
+   next tick boundary. */
+void
+timer_irq_enter (void) {
+	uint64_t now, next_tick;
+
+	if (tick_mode != TICK_STOPPED)
+		return;
+
+	nohz_ticks += tick_catch_up ();
+	now = rdtsc ();
+	next_tick = tick_tsc + tsc_per_tick;
+	clock_oneshot (next_tick > now ? next_tick - now : 0);
+	tick_mode = TICK_RESYNC;
+}
+
+/* Runs each tick that has gone by since the last one, judging by
+   the TSC, rounded to the nearest tick.  Returns the number of
+   ticks run. */
+static int64_t
+tick_catch_up (void) {
+	uint64_t now = rdtsc ();
+	int64_t n = 0;
+
+	while (now + tsc_per_tick / 2 >= tick_tsc + tsc_per_tick) {
+		tick_tsc += tsc_per_tick;
+		do_tick ();
+		n++;
+	}
+	return n;
+}
+
+/* Sets the clock to interrupt every tick, starting one tick from
+   now. */
+static void
+clock_periodic (void) {
+	if (lapic_clock)
+		apic_timer_periodic ();
+	else {
+		outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+		outb (0x40, PIT_COUNT & 0xff);
+		outb (0x40, PIT_COUNT >> 8);
+	}
+}
+
+/* Sets the clock to interrupt just once, CYCLES TSC cycles from
+   now.  The 8254 cannot wait more than 65535 counts, about 5.5
+   ticks, so it may interrupt sooner, which is harmless. */
+static void
+clock_oneshot (uint64_t cycles) {
+	if (lapic_clock)
+		apic_timer_oneshot (cycles, tsc_per_tick);
+	else {
+		uint64_t count = DIV_ROUND_UP (cycles * PIT_COUNT, tsc_per_tick);
+
+		if (count == 0)
+			count = 1;
+		else if (count > 0xffff)
+			count = 0xffff;
+		outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+		outb (0x40, count & 0xff);
+		outb (0x40, count >> 8);
+	}
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
+	if (tick_mode == TICK_RESYNC) {
+		/* Either the interrupt that ended a tickless period, whose
+		   ticks timer_irq_enter() already ran, or the one at the
+		   next tick boundary, after which we go back to periodic
+		   mode. */
+		if (tick_catch_up () == 0)
+			return;
+		clock_periodic ();
+		tick_mode = TICK_PERIODIC;
+		tick_tsc = rdtsc ();
+		return;
+	}
+
+	tick_tsc = rdtsc ();
+	do_tick ();
+}
+
+/* Interrupt handler for an AP's local APIC timer.  The system
+   tick is the BSP's alone, so this only drives the AP's
+   scheduler. */
+static void
+ap_timer_interrupt (struct intr_frame *args UNUSED) {
 	thread_tick ();
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+/* Advances the tick count by one and does the work due on that
+   tick. */
+static void
+do_tick (void) {
+	seqlock_write_begin (&ticks_seq);
+	ticks++;
+	seqlock_write_end (&ticks_seq);
+
+	/* Wake up the sleepers that are due. */
+	while (!heap_empty (&sleep_queue)) {
+		struct thread *t = heap_entry (heap_top (&sleep_queue),
+				struct thread, sleep_elem);
+		if (t->wakeup_tick > ticks)
+			break;
+		heap_pop (&sleep_queue);
+		thread_unblock (t);
+		if (thread_preempts (t))
+			intr_yield_on_return ();
+	}
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+	/* Run expired kernel timers. */
+	ktimer_run (ticks);
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+	thread_tick ();
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Orders sleeping threads by wake-up tick, earliest first. */
+static bool
+wakeup_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+	const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+	return a->wakeup_tick < b->wakeup_tick;
 }
 
-/* Sleep for approximately NUM/DENOM seconds. */
+/* Sleep for approximately NUM/DENOM seconds.  Returns at once if
+   NUM is zero or negative. */
 static void
 real_time_sleep (int64_t num, int32_t denom) {
+	int64_t ticks;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	if (num <= 0)
+		return;
+
 	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
 
 	   (NUM / DENOM) s
 	   ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
 	   1 s / TIMER_FREQ ticks
 	   */
-	int64_t ticks = num * TIMER_FREQ / denom;
-
-	ASSERT (intr_get_level () == INTR_ON);
+	ticks = num * TIMER_FREQ / denom;
 	if (ticks > 0) {
 		/* We're waiting for at least one full timer tick.  Use
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
 		timer_sleep (ticks);
 	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+		/* Otherwise, spin until a TSC deadline for more accurate
+		   sub-tick timing.  NUM is less than DENOM / TIMER_FREQ
+		   here, so NUM * tsc_hz cannot overflow. */
+		uint64_t deadline = rdtsc () + num * tsc_hz / denom;
+
+		while (rdtsc () < deadline)
+			asm volatile ("pause");
 	}
 }
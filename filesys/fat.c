@@ -2,6 +2,7 @@
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
+#include "threads/vmalloc.h"
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
@@ -53,7 +54,7 @@ fat_init (void) {
 
 void
 fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
+	fat_fs->fat = kvcalloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT load failed");
 
@@ -120,7 +121,7 @@ fat_create (void) {
 	fat_fs_init ();
 
 	// Create FAT table
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
+	fat_fs->fat = kvcalloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT creation failed");
 
@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -53,10 +54,15 @@ byte_to_sector (const struct inode *inode, off_t pos) {
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of in-memory inodes.  A `struct inode' is just over 512
+ * bytes, so malloc() would give it a 1 kB block. */
+static struct kmem_cache inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	kmem_cache_init (&inode_cache, "inode", sizeof (struct inode), 0, NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -115,7 +121,7 @@ inode_open (disk_sector_t sector) {
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = kmem_cache_alloc (&inode_cache);
 	if (inode == NULL)
 		return NULL;
 
@@ -164,7 +170,7 @@ inode_close (struct inode *inode) {
 					bytes_to_sectors (inode->data.length)); 
 		}
 
-		free (inode); 
+		kmem_cache_free (&inode_cache, inode);
 	}
 }
 
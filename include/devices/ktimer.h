@@ -0,0 +1,44 @@
+#ifndef DEVICES_KTIMER_H
+#define DEVICES_KTIMER_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel timers: run a callback at a given timer tick.
+
+   A kernel timer is embedded in the structure of whoever needs
+   deferred work, like a list_elem, so adding and cancelling a
+   timer never allocates memory.  Timers are kept in a
+   hierarchical timing wheel that the timer interrupt advances
+   once per tick.  Adding, cancelling and expiring a timer each
+   take O(1) amortized time, however many timers are pending.
+
+   Callbacks run in the timer interrupt handler, with interrupts
+   off, so they must not sleep.  A callback may re-arm its own
+   timer or any other timer.  The ktimer_*() functions may be
+   called from kernel threads or from interrupt handlers. */
+
+typedef void ktimer_func (void *aux);
+
+/* A kernel timer. */
+struct ktimer {
+	struct list_elem elem;      /* Element in a wheel slot. */
+	int64_t expires;            /* Tick at which to run FUNC. */
+	ktimer_func *func;          /* Callback. */
+	void *aux;                  /* Callback argument. */
+	bool pending;               /* Queued in the wheel? */
+};
+
+void ktimer_init (struct ktimer *, ktimer_func *, void *aux);
+void ktimer_add (struct ktimer *, int64_t expires);
+bool ktimer_mod (struct ktimer *, int64_t expires);
+bool ktimer_cancel (struct ktimer *);
+bool ktimer_pending (const struct ktimer *);
+
+void ktimer_wheel_init (int64_t now);
+void ktimer_run (int64_t now);
+int64_t ktimer_next_expiry (void);
+void ktimer_print_stats (void);
+
+#endif /* devices/ktimer.h */
@@ -1,23 +1,34 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <clock.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+extern bool timer_use_lapic;
+extern bool timer_nohz;
+
 void timer_init (void);
-void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
 
+uint64_t timer_tsc_hz (void);
+uint64_t timer_ns (void);
+bool timer_gettime (clockid_t, struct timespec *);
+
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_idle_enter (void);
+void timer_irq_enter (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -119,6 +119,31 @@ static __inline uint64_t rcr2(void) {
 	return val;
 }
 
+__attribute__((always_inline))
+static __inline uint64_t rdtsc(void) {
+	uint32_t lo, hi;
+	__asm __volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/* Returns the index of the most significant set bit of VAL.
+   VAL must be nonzero. */
+__attribute__((always_inline))
+static __inline uint64_t bsrq(uint64_t val) {
+	uint64_t idx;
+	__asm __volatile("bsrq %1, %0" : "=r" (idx) : "rm" (val) : "cc");
+	return idx;
+}
+
+/* Returns the index of the least significant set bit of VAL.
+   VAL must be nonzero. */
+__attribute__((always_inline))
+static __inline uint64_t bsfq(uint64_t val) {
+	uint64_t idx;
+	__asm __volatile("bsfq %1, %0" : "=r" (idx) : "rm" (val) : "cc");
+	return idx;
+}
+
 __attribute__((always_inline))
 static __inline void write_msr(uint32_t ecx, uint64_t val) {
 	uint32_t edx, eax;
@@ -128,4 +153,22 @@ static __inline void write_msr(uint32_t ecx, uint64_t val) {
 			:: "c" (ecx), "d" (edx), "a" (eax) );
 }
 
+__attribute__((always_inline))
+static __inline uint64_t read_msr(uint32_t ecx) {
+	uint32_t edx, eax;
+	__asm __volatile("rdmsr"
+			: "=d" (edx), "=a" (eax) : "c" (ecx));
+	return ((uint64_t) edx << 32) | eax;
+}
+
+/* Executes CPUID for LEAF and stores the results through the
+   given pointers. */
+__attribute__((always_inline))
+static __inline void cpuid(uint32_t leaf, uint32_t *eax, uint32_t *ebx,
+		uint32_t *ecx, uint32_t *edx) {
+	__asm __volatile("cpuid"
+			: "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+			: "a" (leaf), "c" (0));
+}
+
 #endif /* intrinsic.h */
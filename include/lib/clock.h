@@ -0,0 +1,18 @@
+#ifndef __LIB_CLOCK_H
+#define __LIB_CLOCK_H
+
+#include <stdint.h>
+
+/* Clocks that clock_gettime() can read. */
+typedef int clockid_t;
+#define CLOCK_MONOTONIC 1       /* Time since boot. */
+
+#define NSEC_PER_SEC 1000000000
+
+/* A time, in seconds and nanoseconds. */
+struct timespec {
+	int64_t tv_sec;             /* Seconds. */
+	int64_t tv_nsec;            /* Nanoseconds, 0 to NSEC_PER_SEC - 1. */
+};
+
+#endif /* lib/clock.h */
@@ -0,0 +1,16 @@
+#ifndef __LIB_INTR_STATS_H
+#define __LIB_INTR_STATS_H
+
+#include <stdint.h>
+
+/* Statistics for one interrupt vector, as returned by the
+   intr_stats system call. */
+struct intr_stats {
+	int64_t count;              /* # of times the handler ran. */
+	int64_t cycles;             /* Total CPU cycles in the handler. */
+	int64_t max_cycles;         /* Longest single run of the handler. */
+	int64_t nested;             /* # of times it interrupted a handler. */
+	int64_t yields;             /* # of times it yielded on return. */
+};
+
+#endif /* lib/intr-stats.h */
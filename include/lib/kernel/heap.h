@@ -0,0 +1,75 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue.
+ *
+ * This is a pairing heap.  Like the list and hash table
+ * implementations, it does not require dynamic allocation:
+ * each structure that can potentially be in a heap must embed a
+ * struct heap_elem member, and all of the heap functions operate
+ * on these `struct heap_elem's.  The heap_entry macro converts a
+ * struct heap_elem back to the structure that contains it.  See
+ * lib/kernel/list.h for a detailed explanation of the technique.
+ *
+ * The heap is ordered by a caller-supplied heap_less_func.  The
+ * element that is "less" than every other element is at the top
+ * of the heap, so a min-heap uses a "less than" comparison and a
+ * max-heap uses a "greater than" comparison.  Elements that
+ * compare equal come out in unspecified order; include a
+ * tie-breaker in the comparison if that matters.
+ *
+ * Costs, amortized over a sequence of operations on a heap
+ * holding N elements:
+ *
+ * - heap_push(), heap_top(): O(1).
+ *
+ * - heap_pop(), heap_remove(), heap_update(): O(log N). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* Leftmost child. */
+	struct heap_elem *next;     /* Next sibling. */
+	struct heap_elem *prev;     /* Previous sibling, or parent if leftmost. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->child    \
+		- offsetof (STRUCT, MEMBER.child)))
+
+/* Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A belongs closer to the
+   top of the heap than B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Top element, or null if empty. */
+	size_t size;                /* Number of elements. */
+	heap_less_func *less;       /* Ordering function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+/* Insertion and removal. */
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+/* Heap properties. */
+struct heap_elem *heap_top (struct heap *);
+size_t heap_size (struct heap *);
+bool heap_empty (struct heap *);
+
+#endif /* lib/kernel/heap.h */
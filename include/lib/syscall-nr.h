@@ -36,6 +36,13 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Statistics. */
+	SYS_THREAD_STATS,           /* Get scheduling statistics. */
+	SYS_INTR_STATS,             /* Get interrupt statistics. */
+
+	/* Time. */
+	SYS_CLOCK_GETTIME,          /* Read a clock. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,24 @@
+#ifndef __LIB_THREAD_STATS_H
+#define __LIB_THREAD_STATS_H
+
+#include <stdint.h>
+
+/* Number of buckets in the wakeup latency histogram. */
+#define LATENCY_BUCKETS 32
+
+/* Scheduling statistics for one thread, as returned by the
+   thread_stats system call. */
+struct thread_stats {
+	int64_t run_ticks;          /* Timer ticks spent running. */
+	int64_t ready_ticks;        /* Timer ticks spent ready but not running. */
+	int64_t voluntary;          /* # of switches away while blocking. */
+	int64_t involuntary;        /* # of switches away while runnable. */
+
+	/* Wakeup latency: bucket I counts the wakeups after which the
+	   thread waited from 2**I to 2**(I+1) - 1 CPU cycles before it
+	   ran.  Bucket 0 also counts waits under 1 cycle, and the last
+	   bucket all longer ones. */
+	int64_t latency[LATENCY_BUCKETS];
+};
+
+#endif /* lib/thread-stats.h */
@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <clock.h>
+#include <intr-stats.h>
+#include <thread-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -50,6 +53,13 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* Statistics. */
+bool get_thread_stats (struct thread_stats *);
+bool get_intr_stats (int vec, struct intr_stats *);
+
+/* Time. */
+bool clock_gettime (clockid_t, struct timespec *);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
@@ -0,0 +1,23 @@
+#ifndef THREADS_APIC_H
+#define THREADS_APIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Local APIC interrupt vectors, above the ISA IRQs' vectors. */
+#define LAPIC_TIMER_VEC 0xf0    /* An AP's local APIC timer. */
+#define LAPIC_RESCHED_VEC 0xf1  /* Reschedule IPI. */
+
+bool apic_init (void);
+void apic_eoi (void);
+void apic_mask_irq (int irq, bool masked);
+bool apic_timer_init (uint8_t vec, unsigned freq);
+void apic_timer_periodic (void);
+void apic_timer_oneshot (uint64_t num, uint64_t denom);
+
+bool apic_smp_init (void);
+void apic_init_ap (void);
+void apic_start_ap (uint8_t apic_id, uint64_t pa);
+void apic_send_ipi (uint8_t apic_id, uint8_t vec);
+
+#endif /* threads/apic.h */
@@ -0,0 +1,62 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* Most CPUs that the kernel keeps track of. */
+#define CPU_MAX 16
+
+/* Per-CPU state. */
+struct cpu {
+	int id;                     /* Index in cpus[]. */
+	uint8_t apic_id;            /* Local APIC ID. */
+	bool bsp;                   /* Bootstrap processor? */
+	bool online;                /* Running kernel threads? */
+	struct thread *idle;        /* Idle thread, once started. */
+	struct thread *curr;        /* Running thread. */
+
+	/* Scheduling. */
+	unsigned thread_ticks;      /* # of timer ticks since last yield. */
+	bool kicked;                /* Sent a reschedule IPI, not yet taken? */
+
+	/* Interrupt handling.  See threads/interrupt.c. */
+	bool in_external_intr;      /* Processing an external interrupt? */
+	bool yield_on_return;       /* Yield on interrupt return? */
+	unsigned long tlb_gen;      /* tlb_gen when it last flushed its TLB. */
+
+	/* Statistics. */
+	long long idle_ticks;       /* # of timer ticks spent idle. */
+	long long kernel_ticks;     /* # of timer ticks in kernel threads. */
+	long long user_ticks;       /* # of timer ticks in user programs. */
+	long long steals;           /* # of threads taken from other CPUs. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+extern int cpu_online_cnt;
+extern unsigned long tlb_gen;
+extern uint64_t lapic_base;
+
+/* Number of ISA IRQs. */
+#define ISA_IRQ_CNT 16
+
+/* The I/O APIC and how the ISA IRQs are wired to it. */
+extern uint64_t ioapic_base;
+extern uint8_t ioapic_id;
+extern uint8_t isa_irq_pin[ISA_IRQ_CNT];
+extern uint16_t isa_irq_flags[ISA_IRQ_CNT];
+extern bool imcr_present;
+
+void cpu_init (void);
+void cpu_start_aps (void);
+void cpu_ap_main (void) NO_RETURN;
+struct cpu *cpu_current (void);
+void cpu_flush_tlbs (void);
+void cpu_kick_idle (void);
+void cpu_print_stats (void);
+
+#endif /* threads/cpu.h */
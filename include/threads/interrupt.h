@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <intr-stats.h>
 
 /* Interrupts on or off? */
 enum intr_level {
@@ -14,6 +15,7 @@ enum intr_level intr_get_level (void);
 enum intr_level intr_set_level (enum intr_level);
 enum intr_level intr_enable (void);
 enum intr_level intr_disable (void);
+void intr_wait (void);
 
 /* Interrupt stack frame. */
 struct gp_registers {
@@ -65,13 +67,19 @@ struct intr_frame {
 
 typedef void intr_handler_func (struct intr_frame *);
 
+extern bool intr_use_apic;
+extern bool irqoff_enabled;
+
 void intr_init (void);
+void intr_init_ap (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
 bool intr_context (void);
 void intr_yield_on_return (void);
 
+void intr_get_stats (uint8_t vec, struct intr_stats *);
+void intr_print_stats (void);
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
@@ -20,6 +20,11 @@
 #define E820_MAP MULTIBOOT_INFO + 52
 #define E820_MAP4 MULTIBOOT_INFO + 56
 
+/* Physical address at which the application processors start,
+   in real mode, when they receive a startup IPI.  It must be
+   page-aligned and below 1 MB.  See threads/start.S. */
+#define AP_BOOT_BASE 0x8000
+
 /* Important loader physical addresses. */
 #define LOADER_SIG (LOADER_END - LOADER_SIG_LEN)   /* 0xaa55 BIOS signature. */
 #define LOADER_ARGS (LOADER_SIG - LOADER_ARGS_LEN)     /* Command-line args. */
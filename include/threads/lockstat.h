@@ -0,0 +1,28 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Contention statistics for one lock or semaphore, as acquired
+   from one call site. */
+struct lockstat {
+	const void *obj;            /* Lock or semaphore. */
+	const void *site;           /* Return address of the acquire call. */
+	bool is_lock;               /* Lock, as opposed to semaphore? */
+	long long acquired;         /* # of acquisitions. */
+	long long contended;        /* # of acquisitions that had to wait. */
+	uint64_t wait_total;        /* Cycles spent waiting. */
+	uint64_t wait_max;          /* Longest wait, in cycles. */
+	uint64_t hold_total;        /* Cycles held, for locks. */
+};
+
+/* If true, record contention statistics.
+   Controlled by kernel command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
+struct lockstat *lockstat_record (const void *obj, const void *site,
+		bool is_lock, bool contended, uint64_t wait);
+void lockstat_print_stats (void);
+
+#endif /* threads/lockstat.h */
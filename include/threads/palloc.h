@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -11,13 +12,38 @@ enum palloc_flags {
 	PAL_USER = 004              /* User page. */
 };
 
+/* Largest block the buddy allocator keeps on a free list is
+   2**PALLOC_MAX_ORDER pages. */
+#define PALLOC_MAX_ORDER 10
+
+/* Statistics for one page pool. */
+struct palloc_stats {
+	size_t page_cnt;            /* # of pages in the pool. */
+	size_t free_cnt;            /* # of free pages. */
+	size_t blocks[PALLOC_MAX_ORDER + 1]; /* # of free blocks by order. */
+	long long allocs;           /* # of successful allocations. */
+	long long frees;            /* # of calls to free pages. */
+	long long failures;         /* # of allocations that failed. */
+	long long splits;           /* # of blocks split in two. */
+	long long merges;           /* # of buddies coalesced. */
+	size_t zeroed_cnt;          /* # of pre-zeroed pages in reserve. */
+	long long zero_hits;        /* PAL_ZERO pages taken from reserve. */
+	long long zero_misses;      /* PAL_ZERO pages zeroed on demand. */
+};
+
 /* Maximum number of pages to put in user pool. */
 extern size_t user_page_limit;
 
+/* Keep a reserve of pre-zeroed pages?  Cleared by -nozero. */
+extern bool palloc_zero_pool;
+
 uint64_t palloc_init (void);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_zero_idle (void);
+void palloc_get_stats (enum palloc_flags, struct palloc_stats *);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
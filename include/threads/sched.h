@@ -0,0 +1,128 @@
+#ifndef THREADS_SCHED_H
+#define THREADS_SCHED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/cpu.h"
+#include "threads/thread.h"
+
+/* Scheduler classes.
+
+   A scheduler class is a table of operations that implements one
+   scheduling policy.  It owns the run queue of the threads that
+   belong to it and decides which of them runs next.  The core in
+   threads/thread.c does the bookkeeping and the context switch
+   and calls into the class of the thread concerned, so a new
+   policy is added by writing a new class, without touching the
+   switch path.
+
+   Each thread records its class in its `sched_class' member.
+   Threads that declare timing constraints with
+   thread_set_deadline() belong to dl_sched_class
+   (sched-deadline.c), which always runs ahead of the base class.
+   All other threads belong to the base class, which thread_init()
+   selects from the kernel command line:
+
+     - rr_sched_class (sched-rr.c): round-robin among the threads
+       of the highest priority.  The default.
+
+     - mlfqs_sched_class (sched-mlfqs.c): the 4.4BSD multi-level
+       feedback queue scheduler.  "-mlfqs".
+
+     - fair_sched_class (sched-fair.c): fair-share scheduling by
+       weighted virtual runtime.  "-cfs".
+
+   Every operation is called with interrupts off.  Each one is a
+   single indirect call through the thread's class, so the choice
+   of policy costs no more than that on the hot path.  Picking the
+   next thread asks each class in turn, highest first, so it costs
+   one call per class that has nothing ready. */
+struct sched_class {
+	const char *name;
+
+	/* Initializes the class's run queue.  Called once, by
+	   thread_init(). */
+	void (*init) (void);
+
+	/* Adds T, which was just created or woken up, to the run
+	   queue. */
+	void (*enqueue) (struct thread *t);
+
+	/* Removes ready thread T from the run queue. */
+	void (*dequeue) (struct thread *t);
+
+	/* Removes and returns the thread that should run next, or a
+	   null pointer if the run queue is empty. */
+	struct thread *(*pick_next) (void);
+
+	/* Puts running thread CURR, which is giving up the CPU but
+	   stays runnable, back on the run queue. */
+	void (*yield) (struct thread *curr);
+
+	/* Charges a timer tick to running thread CURR, which may be
+	   the idle thread, and which has run for TICKS_RUN ticks since
+	   it was scheduled.  Returns true if CURR should be preempted.
+	   Called from the timer interrupt. */
+	bool (*tick) (struct thread *curr, unsigned ticks_run);
+
+	/* Called after the priority of T, which is ready or running,
+	   changed from OLD_PRIORITY.  Returns true if the running
+	   thread should yield as a result. */
+	bool (*prio_changed) (struct thread *t, int old_priority);
+
+	/* Returns true if ready thread T should run in place of the
+	   running thread CURR. */
+	bool (*preempts) (const struct thread *t, const struct thread *curr);
+
+	/* Optional.  Sets up new thread T, created by PARENT, before it
+	   is first enqueued. */
+	void (*fork) (struct thread *t, const struct thread *parent);
+
+	/* Optional.  Called after the nice value of running thread CURR
+	   changed.  Returns true if CURR should yield as a result. */
+	bool (*nice_changed) (struct thread *curr);
+
+	/* Optional.  Class-wide bookkeeping, called on every timer tick
+	   before the running thread's class's tick(), whatever class
+	   CURR, the running thread, belongs to. */
+	void (*clock) (struct thread *curr);
+
+	/* Optional.  Called when running thread CURR has just moved
+	   into this class from another one. */
+	void (*switched_to) (struct thread *curr);
+
+	/* Optional.  Called when running thread CURR exits. */
+	void (*exit) (struct thread *curr);
+
+	/* Optional.  Prints the class's statistics. */
+	void (*print_stats) (void);
+};
+
+extern const struct sched_class dl_sched_class;
+extern const struct sched_class rr_sched_class;
+extern const struct sched_class mlfqs_sched_class;
+extern const struct sched_class fair_sched_class;
+
+/* # of timer ticks to give each thread under the round-robin and
+   MLFQS classes. */
+#define TIME_SLICE 4
+
+/* Scheduler class of threads that are not deadline threads. */
+extern const struct sched_class *base_class;
+
+/* The running CPU's idle thread.  It runs when every run queue is
+   empty and is never on a run queue itself, except once when the
+   BSP's is created. */
+#define idle_thread (cpu_current ()->idle)
+
+/* Priority run queue of the round-robin class, which the MLFQS
+   class shares. */
+void rr_enqueue (struct thread *);
+void rr_dequeue (struct thread *);
+struct thread *rr_pick_next (void);
+void rr_yield (struct thread *);
+bool rr_preempts (const struct thread *, const struct thread *);
+int rr_max_priority (void);
+size_t rr_nr_ready (void);
+
+#endif /* threads/sched.h */
@@ -0,0 +1,42 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Initializes an object just after its slab is allocated. */
+typedef void kmem_ctor (void *obj);
+
+/* A cache of objects of one type. */
+struct kmem_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t obj_size;            /* Object size, rounded up to ALIGN. */
+	size_t align;               /* Object alignment. */
+	kmem_ctor *ctor;            /* Constructor, or null. */
+	size_t objs_per_slab;       /* # of objects in each slab. */
+	size_t obj_ofs;             /* Offset of first object in a slab. */
+	struct lock lock;           /* Protects the slab lists. */
+	struct list partial;        /* Slabs with some objects free. */
+	struct list full;           /* Slabs with no objects free. */
+	struct list empty;          /* Slabs with all objects free. */
+	struct list_elem elem;      /* Element in list of all caches. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* # of slabs. */
+	size_t active_cnt;          /* # of objects allocated. */
+	long long allocs;           /* # of objects allocated. */
+	long long frees;            /* # of objects freed. */
+	long long grows;            /* # of slabs allocated. */
+	long long reaps;            /* # of slabs released. */
+};
+
+void slab_init (void);
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+		size_t align, kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_cache_shrink (struct kmem_cache *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -0,0 +1,32 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+/* switch_threads()'s stack frame: the registers that the System V
+   calling convention requires a function to preserve, pushed in
+   this order below the return address. */
+struct switch_threads_frame {
+	uint64_t r15;               /*  0: Saved %r15. */
+	uint64_t r14;               /*  8: Saved %r14. */
+	uint64_t r13;               /* 16: Saved %r13. */
+	uint64_t r12;               /* 24: Saved %r12. */
+	uint64_t rbp;               /* 32: Saved %rbp. */
+	uint64_t rbx;               /* 40: Saved %rbx. */
+	void (*rip) (void);         /* 48: Return address. */
+};
+
+struct thread;
+
+/* Switches from CUR, which must be the running thread, to NEXT,
+   which must also be running switch_threads(), returning CUR in
+   NEXT's context. */
+struct thread *switch_threads (struct thread *cur, struct thread *next);
+
+/* Where a new thread first returns from switch_threads().  Jumps
+   to the function in %rbx with %r12 and %r13 as its arguments. */
+void switch_entry (void);
+#endif
+
+#endif /* threads/switch.h */
@@ -1,13 +1,17 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, by priority. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -15,11 +19,15 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
+void synch_priority_changed (struct thread *);
 
 /* Lock. */
 struct lock {
-	struct thread *holder;      /* Thread holding lock (for debugging). */
+	struct thread *holder;      /* Thread holding lock. */
+	struct list_elem elem;      /* Element in holder's held_locks. */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct lockstat *stat;      /* Holder's statistics, with -lockstat. */
+	uint64_t acquired_at;       /* TSC when acquired, with -lockstat. */
 };
 
 void lock_init (struct lock *);
@@ -28,9 +36,11 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+extern int lock_donation_depth;
+
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, by priority. */
 };
 
 void cond_init (struct condition *);
@@ -38,6 +48,32 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock. */
+struct rwlock {
+	unsigned readers;           /* # of threads holding it for reading. */
+	struct thread *writer;      /* Thread holding it for writing. */
+	struct list_elem elem;      /* Element in writer's held_rwlocks. */
+	struct heap read_waiters;   /* Threads waiting to read, by priority. */
+	struct heap write_waiters;  /* Threads waiting to write, by priority. */
+};
+
+void rwlock_init (struct rwlock *);
+void rwlock_read_acquire (struct rwlock *);
+void rwlock_read_release (struct rwlock *);
+void rwlock_write_acquire (struct rwlock *);
+void rwlock_write_release (struct rwlock *);
+
+/* Sequence lock. */
+struct seqlock {
+	unsigned seq;               /* Odd while a write is in progress. */
+};
+
+void seqlock_init (struct seqlock *);
+void seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
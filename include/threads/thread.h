@@ -2,14 +2,21 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
+#include <thread-stats.h>
+#include "threads/fixed-point.h"
 #include "threads/interrupt.h"
+#include "devices/ktimer.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
 
 
+struct cpu;
+struct sched_class;
+
 /* States in a thread's life cycle. */
 enum thread_status {
 	THREAD_RUNNING,     /* Running thread. */
@@ -28,6 +35,29 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread nice values, for the multi-level feedback queue
+   scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default nice value. */
+#define NICE_MAX 20                     /* Least nice to other threads. */
+
+/* Deadline scheduling parameters and state of a thread.  Times
+   are in timer ticks.  Owned by threads/sched-deadline.c. */
+struct sched_dl {
+	int64_t runtime;                    /* CPU time needed per period. */
+	int64_t deadline;                   /* Deadline, from period start. */
+	int64_t period;                     /* Period length. */
+	int64_t release;                    /* Start of current period. */
+	int64_t abs_deadline;               /* Deadline of current period. */
+	int64_t budget;                     /* CPU time left this period. */
+	bool throttled;                     /* Out of budget, off run queue? */
+	bool waiting;                       /* Blocked until next period? */
+	bool job_done;                      /* Work of this period done? */
+	bool job_missed;                    /* Miss counted for this period? */
+	int misses;                         /* # of deadlines missed. */
+	struct ktimer timer;                /* Fires at next period start. */
+};
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -90,11 +120,40 @@ struct thread {
 	tid_t tid;                          /* Thread identifier. */
 	enum thread_status status;          /* Thread state. */
 	char name[16];                      /* Name (for debugging purposes). */
-	int priority;                       /* Priority. */
+	int priority;                       /* Effective priority. */
+	int base_priority;                  /* Priority before donations. */
+	int nice;                           /* Nice value, for MLFQS. */
+	fixed_t recent_cpu;                 /* Recent CPU usage, for MLFQS. */
+	uint64_t vruntime;                  /* Virtual runtime, for -cfs. */
+	struct heap_elem rq_elem;           /* Fair-share run queue element. */
+	const struct sched_class *sched_class; /* Scheduling policy. */
+	struct cpu *cpu;                    /* CPU it runs on or is queued for. */
+	struct sched_dl dl;                 /* For the deadline class. */
+	struct list_elem allelem;           /* List element for all threads list. */
+
+	/* Statistics, owned by thread.c. */
+	struct thread_stats stats;          /* Scheduling statistics. */
+	int64_t ready_since;                /* Tick it last became ready. */
+	uint64_t wake_tsc;                  /* TSC when it last woke up. */
+	bool woken;                         /* Woken up but not yet run? */
+	int intr_depth;                     /* Nesting of intr_handler(). */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 
+	/* Owned by synch.c. */
+	struct list held_locks;             /* Locks held, for donation. */
+	struct list held_rwlocks;           /* Rwlocks held to write, ditto. */
+	struct lock *waiting_lock;          /* Lock being waited for, if any. */
+	struct heap_elem wait_elem;         /* Semaphore wait queue element. */
+	uint64_t wait_seq;                  /* Arrival order in wait queue. */
+	struct heap *wait_queue;            /* Wait queue it is in, if any. */
+	struct heap_elem *wait_queue_elem;  /* Its element in wait_queue. */
+
+	/* Owned by devices/timer.c. */
+	int64_t wakeup_tick;                /* Tick to wake up at in timer_sleep(). */
+	struct heap_elem sleep_elem;        /* Sleep queue element. */
+
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
@@ -106,6 +165,7 @@ struct thread {
 
 	/* Owned by thread.c. */
 	struct intr_frame tf;               /* Information for switching */
+	uint8_t *stack;                     /* Saved stack pointer. */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
@@ -114,17 +174,25 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the fair-share scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_create_idle (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_get_stats (struct thread_stats *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+bool thread_preempts (const struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -133,14 +201,25 @@ const char *thread_name (void);
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
 
+/* Performs some operation on thread t, given auxiliary data AUX. */
+typedef void thread_action_func (struct thread *t, void *aux);
+void thread_foreach (thread_action_func *, void *);
+
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, int priority);
+bool thread_update_priority (struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
+bool thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period);
+void thread_clear_deadline (void);
+void thread_deadline_yield (void);
+int thread_get_deadline_misses (void);
+
 void do_iret (struct intr_frame *tf);
 
 #endif /* threads/thread.h */
@@ -0,0 +1,25 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/vaddr.h"
+
+/* Range of kernel virtual addresses for vmalloc().  It lies in
+   the same page map level 4 entry as the mapping of physical
+   memory at KERN_BASE, well above it, so every page table
+   created by pml4_create() shares it. */
+#define VMALLOC_START (KERN_BASE + 0x1000000000)
+#define VMALLOC_END (VMALLOC_START + 0x10000000)
+
+void vmalloc_init (void);
+void *vmalloc (size_t) __attribute__ ((malloc));
+void *vzalloc (size_t) __attribute__ ((malloc));
+void vfree (void *);
+bool is_vmalloc_addr (const void *);
+void *kvmalloc (size_t) __attribute__ ((malloc));
+void *kvcalloc (size_t, size_t) __attribute__ ((malloc));
+void kvfree (void *);
+void vmalloc_print_stats (void);
+
+#endif /* threads/vmalloc.h */
@@ -0,0 +1,32 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Work queue priorities. */
+enum work_prio {
+	WORK_HIGH,                  /* Worker at PRI_MAX. */
+	WORK_NORMAL,                /* Worker at PRI_DEFAULT. */
+	WORK_PRIO_CNT
+};
+
+typedef void work_func (void *aux);
+
+/* A deferred piece of work. */
+struct work {
+	struct list_elem elem;      /* Work queue element. */
+	work_func *func;            /* Function to call. */
+	void *aux;                  /* Argument to pass. */
+	bool pending;               /* Scheduled but not yet started? */
+	uint64_t queued_at;         /* TSC when scheduled. */
+};
+
+void workqueue_init (void);
+void workqueue_start (void);
+void work_init (struct work *, work_func *, void *aux);
+bool work_schedule (struct work *, enum work_prio);
+void workqueue_print_stats (void);
+
+#endif /* threads/workqueue.h */
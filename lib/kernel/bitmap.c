@@ -4,6 +4,7 @@
 #include <round.h>
 #include <stdio.h>
 #include "threads/malloc.h"
+#include "threads/vmalloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
 #endif
@@ -74,7 +75,7 @@ bitmap_create (size_t bit_cnt) {
 	struct bitmap *b = malloc (sizeof *b);
 	if (b != NULL) {
 		b->bit_cnt = bit_cnt;
-		b->bits = malloc (byte_cnt (bit_cnt));
+		b->bits = kvmalloc (byte_cnt (bit_cnt));
 		if (b->bits != NULL || bit_cnt == 0) {
 			bitmap_set_all (b, false);
 			return b;
@@ -112,7 +113,7 @@ bitmap_buf_size (size_t bit_cnt) {
 void
 bitmap_destroy (struct bitmap *b) {
 	if (b != NULL) {
-		free (b->bits);
+		kvfree (b->bits);
 		free (b);
 	}
 }
@@ -0,0 +1,184 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a heap-ordered multiway tree.  Each node
+   keeps a pointer to its leftmost child, and the children of a
+   node form a doubly linked sibling list.  The `prev' link of a
+   leftmost child points to its parent instead of a sibling,
+   which is enough to unlink any node in constant time.
+
+   Two heaps are melded by making the root that loses the
+   comparison the new leftmost child of the winner.  Popping the
+   root melds its children back together in two passes: first
+   pairwise from left to right, then accumulating the pairs from
+   right to left.  This "two-pass" pairing is what gives the
+   O(log N) amortized bound for removal. */
+
+static struct heap_elem *meld (struct heap *,
+		struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes HEAP as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux) {
+	ASSERT (heap != NULL);
+	ASSERT (less != NULL);
+
+	heap->root = NULL;
+	heap->size = 0;
+	heap->less = less;
+	heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem) {
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+
+	elem->child = elem->next = elem->prev = NULL;
+	heap->root = meld (heap, heap->root, elem);
+	heap->size++;
+}
+
+/* Removes the top element from HEAP and returns it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_pop (struct heap *heap) {
+	struct heap_elem *top = heap_top (heap);
+
+	heap->root = merge_pairs (heap, top->child);
+	heap->size--;
+	top->child = NULL;
+	return top;
+}
+
+/* Removes ELEM, which must be in HEAP, from HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem) {
+	struct heap_elem *sub;
+
+	ASSERT (heap != NULL);
+	ASSERT (elem != NULL);
+	ASSERT (heap->size > 0);
+
+	if (elem == heap->root) {
+		heap_pop (heap);
+		return;
+	}
+
+	/* Unlink ELEM from its parent or left sibling. */
+	ASSERT (elem->prev != NULL);
+	if (elem->prev->child == elem)
+		elem->prev->child = elem->next;
+	else
+		elem->prev->next = elem->next;
+	if (elem->next != NULL)
+		elem->next->prev = elem->prev;
+
+	/* Put ELEM's subtrees back. */
+	sub = merge_pairs (heap, elem->child);
+	heap->root = meld (heap, heap->root, sub);
+	heap->size--;
+	elem->child = elem->next = elem->prev = NULL;
+}
+
+/* Restores the heap order after the key of ELEM, which must be
+   in HEAP, was changed in either direction. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem) {
+	heap_remove (heap, elem);
+	heap_push (heap, elem);
+}
+
+/* Returns the top element of HEAP without removing it.
+   Undefined behavior if HEAP is empty. */
+struct heap_elem *
+heap_top (struct heap *heap) {
+	ASSERT (heap != NULL);
+	ASSERT (heap->root != NULL);
+
+	return heap->root;
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (struct heap *heap) {
+	ASSERT (heap != NULL);
+
+	return heap->root == NULL;
+}
+
+/* Melds the trees rooted at A and B, either of which may be
+   null, and returns the root of the result.  A and B must not
+   have siblings. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b) {
+	struct heap_elem *tmp;
+
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	if (heap->less (b, a, heap->aux)) {
+		tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* Make B the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single tree
+   and returns its root, or a null pointer if FIRST is null. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* First pass: meld siblings pairwise from left to right,
+	   stacking the results on PAIRS through their `next' links. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+		struct heap_elem *m;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+
+		m = meld (heap, a, b);
+		m->next = pairs;
+		pairs = m;
+	}
+
+	/* Second pass: meld the pairs from right to left. */
+	while (pairs != NULL) {
+		struct heap_elem *m = pairs;
+
+		pairs = m->next;
+		m->next = NULL;
+		root = meld (heap, root, m);
+	}
+
+	if (root != NULL)
+		root->prev = root->next = NULL;
+	return root;
+}
@@ -194,3 +194,18 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+bool
+get_thread_stats (struct thread_stats *stats) {
+	return syscall1 (SYS_THREAD_STATS, stats);
+}
+
+bool
+get_intr_stats (int vec, struct intr_stats *stats) {
+	return syscall2 (SYS_INTR_STATS, vec, stats);
+}
+
+bool
+clock_gettime (clockid_t clock, struct timespec *ts) {
+	return syscall2 (SYS_CLOCK_GETTIME, clock, ts);
+}
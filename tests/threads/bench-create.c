@@ -0,0 +1,62 @@
+/* Measures the cost of creating a thread.
+
+   The main thread repeatedly creates a higher-priority thread
+   that exits at once, so each round trip covers thread_create(),
+   two thread switches, and thread_exit().  After warming up, the
+   dead threads' pages are recycled, so thread_create() should not
+   reach the page allocator.  For comparison, the test also times
+   allocating a zeroed page and freeing it, which is what every
+   thread creation used to cost on top of the rest. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define WARMUP_CNT 100
+#define CREATE_CNT 2000
+
+static thread_func exit_thread;
+
+void
+test_bench_create (void)
+{
+  struct palloc_stats before, after;
+  uint64_t start, create_cycles, palloc_cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < WARMUP_CNT; i++)
+    thread_create ("exit", PRI_MAX, exit_thread, NULL);
+
+  palloc_get_stats (0, &before);
+  start = rdtsc ();
+  for (i = 0; i < CREATE_CNT; i++)
+    thread_create ("exit", PRI_MAX, exit_thread, NULL);
+  create_cycles = rdtsc () - start;
+  palloc_get_stats (0, &after);
+  if (after.allocs != before.allocs)
+    fail ("%lld pages allocated while creating threads, should be 0",
+          after.allocs - before.allocs);
+
+  start = rdtsc ();
+  for (i = 0; i < CREATE_CNT; i++)
+    palloc_free_page (palloc_get_page (PAL_ZERO));
+  palloc_cycles = rdtsc () - start;
+
+  msg ("%d threads created from recycled pages.", CREATE_CNT);
+  msg ("%d threads: %llu cycles per create and exit.",
+       CREATE_CNT, create_cycles / CREATE_CNT);
+  msg ("%d zeroed pages: %llu cycles per allocate and free.",
+       CREATE_CNT, palloc_cycles / CREATE_CNT);
+  pass ();
+}
+
+static void
+exit_thread (void *aux UNUSED)
+{
+}
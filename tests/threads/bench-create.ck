@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts vary from run to run.
+s/: \d+ cycles per /: # cycles per / foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-create) begin
+(bench-create) 2000 threads created from recycled pages.
+(bench-create) 2000 threads: # cycles per create and exit.
+(bench-create) 2000 zeroed pages: # cycles per allocate and free.
+(bench-create) PASS
+(bench-create) end
+EOF
+pass;
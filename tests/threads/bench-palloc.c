@@ -0,0 +1,139 @@
+/* Measures the page allocator and reports how fragmented it
+   leaves the user pool.
+
+   First a single page is allocated and freed over and over.
+   Then the test keeps up to SLOT_CNT blocks of 1 to MAX_PAGES
+   pages allocated at a time, freeing and allocating them in
+   random order for CYCLE_CNT cycles, and reports the average
+   cost of each operation and the state of the free lists while
+   they are all still allocated.  Finally it frees everything and
+   checks that the buddy allocator coalesced the pool back into
+   exactly the blocks it started with. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "intrinsic.h"
+
+#define SINGLE_CNT 10000
+#define SLOT_CNT 64
+#define MAX_PAGES 16
+#define CYCLE_CNT 20000
+
+struct slot
+  {
+    void *pages;
+    size_t page_cnt;
+  };
+
+static struct slot slots[SLOT_CNT];
+
+static size_t random_page_cnt (void);
+static void report (const char *when, const struct palloc_stats *);
+
+void
+test_bench_palloc (void)
+{
+  struct palloc_stats before, after;
+  uint64_t start, cycles;
+  long long failures = 0;
+  int i;
+
+  palloc_get_stats (PAL_USER, &before);
+  report ("Before", &before);
+
+  start = rdtsc ();
+  for (i = 0; i < SINGLE_CNT; i++)
+    palloc_free_page (palloc_get_page (PAL_USER | PAL_ASSERT));
+  cycles = rdtsc () - start;
+  msg ("%d single pages: %llu cycles per alloc and free.",
+       SINGLE_CNT, cycles / SINGLE_CNT);
+
+  random_init (0);
+  start = rdtsc ();
+  for (i = 0; i < CYCLE_CNT; i++)
+    {
+      struct slot *s = &slots[random_ulong () % SLOT_CNT];
+
+      if (s->pages != NULL)
+        {
+          palloc_free_multiple (s->pages, s->page_cnt);
+          s->pages = NULL;
+        }
+      else
+        {
+          s->page_cnt = random_page_cnt ();
+          s->pages = palloc_get_multiple (PAL_USER, s->page_cnt);
+          if (s->pages == NULL)
+            failures++;
+        }
+    }
+  cycles = rdtsc () - start;
+  msg ("%d mixed operations: %llu cycles each, %lld failures.",
+       CYCLE_CNT, cycles / CYCLE_CNT, failures);
+
+  palloc_get_stats (PAL_USER, &after);
+  report ("Loaded", &after);
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (slots[i].pages != NULL)
+      {
+        palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+        slots[i].pages = NULL;
+      }
+
+  palloc_get_stats (PAL_USER, &after);
+  report ("After", &after);
+  msg ("%lld splits, %lld merges.",
+       after.splits - before.splits, after.merges - before.merges);
+
+  if (after.free_cnt != before.free_cnt)
+    fail ("%zu pages free before, %zu after.",
+          before.free_cnt, after.free_cnt);
+  if (memcmp (after.blocks, before.blocks, sizeof before.blocks))
+    fail ("free blocks were not coalesced.");
+  msg ("Free blocks coalesced back to where they started.");
+  pass ();
+}
+
+/* Returns a random block size, biased toward small blocks the
+   way real allocations are. */
+static size_t
+random_page_cnt (void)
+{
+  switch (random_ulong () % 4)
+    {
+    case 0:
+    case 1:
+      return 1;
+    case 2:
+      return 1 + random_ulong () % 4;
+    default:
+      return 1 + random_ulong () % MAX_PAGES;
+    }
+}
+
+/* Reports the free pages and free blocks in STATS, labeled
+   WHEN. */
+static void
+report (const char *when, const struct palloc_stats *stats)
+{
+  char orders[128];
+  size_t largest = 0, ofs = 0;
+  int order;
+
+  for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+    {
+      if (stats->blocks[order] > 0)
+        largest = (size_t) 1 << order;
+      ofs += snprintf (orders + ofs, sizeof orders - ofs, " %zu",
+                       stats->blocks[order]);
+    }
+  msg ("%s: %zu pages free, largest block %zu pages, "
+       "%zu%% fragmented.", when, stats->free_cnt, largest,
+       stats->free_cnt > 0 && largest < stats->free_cnt
+       ? 100 - largest * 100 / stats->free_cnt : 0);
+  msg ("%s: free blocks by order:%s", when, orders);
+}
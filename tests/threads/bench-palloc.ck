@@ -0,0 +1,47 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Once everything is freed, the pool must report exactly the free
+# pages and blocks it started with.
+my (%report) = (Before => '', After => '');
+local ($_);
+foreach (@output) {
+    my ($when, $what) = /^\(bench-palloc\) (Before|After): (.*)$/
+      or next;
+    $report{$when} .= "  $what\n";
+}
+fail "Free lists differ after freeing everything.\n"
+  . "Before:\n$report{Before}After:\n$report{After}"
+  if $report{Before} ne $report{After};
+
+# The pool's size depends on the memory and kernel sizes, and
+# cycle counts vary from run to run, so mask them.
+foreach (@output) {
+    s/: \d+ pages free, largest block \d+ pages, \d+% fragmented\.$/: # pages free, largest block # pages, #% fragmented./;
+    s/: free blocks by order:[ \d]*$/: free blocks by order: #/;
+    s/: \d+ cycles /: # cycles /;
+    s/^\(bench-palloc\) \d+ splits, \d+ merges\.$/(bench-palloc) # splits, # merges./;
+}
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-palloc) begin
+(bench-palloc) Before: # pages free, largest block # pages, #% fragmented.
+(bench-palloc) Before: free blocks by order: #
+(bench-palloc) 10000 single pages: # cycles per alloc and free.
+(bench-palloc) 20000 mixed operations: # cycles each, 0 failures.
+(bench-palloc) Loaded: # pages free, largest block # pages, #% fragmented.
+(bench-palloc) Loaded: free blocks by order: #
+(bench-palloc) After: # pages free, largest block # pages, #% fragmented.
+(bench-palloc) After: free blocks by order: #
+(bench-palloc) # splits, # merges.
+(bench-palloc) Free blocks coalesced back to where they started.
+(bench-palloc) PASS
+(bench-palloc) end
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* Measures the cost of picking the next thread to run as the
+   number of ready threads grows.
+
+   The main thread fills the run queue with DEPTH threads spread
+   across the priorities below its own, then times a series of
+   thread_yield() calls.  Each yield puts the main thread back on
+   the run queue and asks the scheduler for the highest-priority
+   ready thread, which is the main thread again, so no context
+   switch takes place and the measurement isolates the run queue.
+   With a constant-time run queue the cycles per pick should not
+   depend on DEPTH. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define YIELD_CNT 10000
+
+static thread_func filler_thread;
+
+static const int depths[] = {5, 50, 500, 1000};
+
+void
+test_bench_runqueue (void)
+{
+  size_t i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  for (i = 0; i < sizeof depths / sizeof *depths; i++)
+    {
+      enum intr_level old_level;
+      uint64_t start, cycles;
+      int created, j;
+
+      for (created = 0; created < depths[i]; created++)
+        {
+          int priority = PRI_MIN + 1 + created % (PRI_DEFAULT - PRI_MIN - 1);
+          if (thread_create ("filler", priority, filler_thread, NULL)
+              == TID_ERROR)
+            fail ("out of memory after %d threads", created);
+        }
+
+      old_level = intr_disable ();
+      start = rdtsc ();
+      for (j = 0; j < YIELD_CNT; j++)
+        thread_yield ();
+      cycles = rdtsc () - start;
+      intr_set_level (old_level);
+
+      msg ("%d ready threads: %llu cycles per pick.",
+           created, cycles / YIELD_CNT);
+
+      /* Let the fillers run to completion. */
+      thread_set_priority (PRI_MIN);
+      thread_set_priority (PRI_DEFAULT);
+    }
+  pass ();
+}
+
+static void
+filler_thread (void *aux UNUSED)
+{
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts vary from run to run, so check only that every
+# depth was measured, in order.
+s/: \d+ cycles per pick\.$/: # cycles per pick./ foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-runqueue) begin
+(bench-runqueue) 5 ready threads: # cycles per pick.
+(bench-runqueue) 50 ready threads: # cycles per pick.
+(bench-runqueue) 500 ready threads: # cycles per pick.
+(bench-runqueue) 1000 ready threads: # cycles per pick.
+(bench-runqueue) PASS
+(bench-runqueue) end
+EOF
+pass;
@@ -0,0 +1,146 @@
+/* Compares reader throughput under a reader-writer lock against
+   a plain lock, and the cost of reading the tick counter under
+   its sequence lock.
+
+   READER_CNT threads each enter a read-side critical section
+   ROUND_CNT times.  Inside it, a reader yields the CPU, standing
+   in for a reader that blocks, for example on disk I/O during a
+   directory lookup.  With a plain lock the other readers must
+   wait for it; with a reader-writer lock they proceed.  The test
+   checks how many readers were inside at once, which must be 1
+   with the lock and READER_CNT with the reader-writer lock, and
+   reports the cycles per read-side critical section for each.
+
+   Finally the test reports the cycles per timer_ticks() call,
+   which reads the tick counter under a sequence lock instead of
+   turning interrupts off. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define READER_CNT 8
+#define ROUND_CNT 500
+#define TICKS_CNT 100000
+
+struct bench
+  {
+    struct lock lock;
+    struct rwlock rwlock;
+    bool use_rwlock;
+    struct semaphore done;
+    int inside;                 /* # of readers inside now. */
+    int max_inside;             /* Most readers inside at once. */
+  };
+
+static thread_func reader_thread;
+static uint64_t run_readers (struct bench *, bool use_rwlock);
+static void enter (struct bench *);
+static void leave (struct bench *);
+
+void
+test_bench_rwlock (void)
+{
+  struct bench b;
+  uint64_t lock_cycles, rwlock_cycles, start;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&b.lock);
+  rwlock_init (&b.rwlock);
+  sema_init (&b.done, 0);
+
+  lock_cycles = run_readers (&b, false);
+  msg ("struct lock: %d reader(s) inside at once.", b.max_inside);
+  if (b.max_inside != 1)
+    fail ("a plain lock admitted more than one reader");
+  rwlock_cycles = run_readers (&b, true);
+  msg ("struct rwlock: %d reader(s) inside at once.", b.max_inside);
+  if (b.max_inside != READER_CNT)
+    fail ("readers did not all share the reader-writer lock");
+  msg ("struct lock: %llu cycles per read.",
+       lock_cycles / (READER_CNT * ROUND_CNT));
+  msg ("struct rwlock: %llu cycles per read.",
+       rwlock_cycles / (READER_CNT * ROUND_CNT));
+
+  start = rdtsc ();
+  for (i = 0; i < TICKS_CNT; i++)
+    timer_ticks ();
+  msg ("timer_ticks(): %llu cycles per call.",
+       (rdtsc () - start) / TICKS_CNT);
+  pass ();
+}
+
+/* Runs READER_CNT readers against B, using its rwlock if
+   USE_RWLOCK is true and its lock otherwise, and returns the
+   cycles they took. */
+static uint64_t
+run_readers (struct bench *b, bool use_rwlock)
+{
+  uint64_t start;
+  int i;
+
+  b->use_rwlock = use_rwlock;
+  b->inside = b->max_inside = 0;
+  start = rdtsc ();
+  for (i = 0; i < READER_CNT; i++)
+    thread_create ("reader", PRI_DEFAULT, reader_thread, b);
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&b->done);
+  return rdtsc () - start;
+}
+
+static void
+reader_thread (void *b_)
+{
+  struct bench *b = b_;
+  int i;
+
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      if (b->use_rwlock)
+        {
+          rwlock_read_acquire (&b->rwlock);
+          enter (b);
+          thread_yield ();
+          leave (b);
+          rwlock_read_release (&b->rwlock);
+        }
+      else
+        {
+          lock_acquire (&b->lock);
+          enter (b);
+          thread_yield ();
+          leave (b);
+          lock_release (&b->lock);
+        }
+      thread_yield ();
+    }
+  sema_up (&b->done);
+}
+
+/* Counts a reader into B's critical section. */
+static void
+enter (struct bench *b)
+{
+  enum intr_level old_level = intr_disable ();
+  if (++b->inside > b->max_inside)
+    b->max_inside = b->inside;
+  intr_set_level (old_level);
+}
+
+/* Counts a reader out of B's critical section. */
+static void
+leave (struct bench *b)
+{
+  enum intr_level old_level = intr_disable ();
+  b->inside--;
+  intr_set_level (old_level);
+}
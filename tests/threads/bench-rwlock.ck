@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts vary from run to run.
+s/: \d+ cycles per (read|call)\.$/: # cycles per $1./ foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-rwlock) begin
+(bench-rwlock) struct lock: 1 reader(s) inside at once.
+(bench-rwlock) struct rwlock: 8 reader(s) inside at once.
+(bench-rwlock) struct lock: # cycles per read.
+(bench-rwlock) struct rwlock: # cycles per read.
+(bench-rwlock) timer_ticks(): # cycles per call.
+(bench-rwlock) PASS
+(bench-rwlock) end
+EOF
+pass;
@@ -0,0 +1,102 @@
+/* Measures the block and string routines in lib/string.c over
+   sizes from 8 bytes to 64 kB, next to a plain byte-at-a-time
+   copy loop for comparison.  Each line of output gives the
+   average cycles per call at one size.  The results of each
+   routine are checked along the way. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#define MAX_SIZE (64 * 1024)
+#define BUF_PAGES (MAX_SIZE / PGSIZE + 1)
+
+/* Bytes to process at each size, so that small sizes get enough
+   calls to time. */
+#define BYTES_PER_SIZE (1024 * 1024)
+
+static const size_t sizes[] = { 8, 64, 512, 4096, MAX_SIZE };
+
+static void byte_copy (uint8_t *dst, const uint8_t *src, size_t size);
+
+void
+test_bench_string (void)
+{
+  uint8_t *a = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  uint8_t *b = palloc_get_multiple (PAL_ASSERT, BUF_PAGES);
+  size_t i;
+
+  for (i = 0; i < BUF_PAGES * PGSIZE; i++)
+    a[i] = 'a' + i % 26;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i];
+      int iter_cnt = BYTES_PER_SIZE / size, j, diff = 0;
+      uint64_t start, bytes, copy, set, move, cmp, len;
+
+      start = rdtsc ();
+      for (j = 0; j < iter_cnt; j++)
+        byte_copy (b, a, size);
+      bytes = (rdtsc () - start) / iter_cnt;
+
+      start = rdtsc ();
+      for (j = 0; j < iter_cnt; j++)
+        memcpy (b, a, size);
+      copy = (rdtsc () - start) / iter_cnt;
+      if (memcmp (a, b, size))
+        fail ("memcpy of %zu bytes is wrong", size);
+
+      start = rdtsc ();
+      for (j = 0; j < iter_cnt; j++)
+        diff |= memcmp (a, b, size);
+      cmp = (rdtsc () - start) / iter_cnt;
+      if (diff != 0)
+        fail ("memcmp of %zu equal bytes is wrong", size);
+
+      start = rdtsc ();
+      for (j = 0; j < iter_cnt; j++)
+        memmove (b + 1, b, size);
+      move = (rdtsc () - start) / iter_cnt;
+      /* Each call shifted B up by a byte. */
+      if (b[size] != a[(size_t) iter_cnt <= size ? size - iter_cnt : 0]
+          || memchr (b + 1, '\0', size) != NULL)
+        fail ("memmove of %zu bytes is wrong", size);
+
+      start = rdtsc ();
+      for (j = 0; j < iter_cnt; j++)
+        memset (b, 0, size);
+      set = (rdtsc () - start) / iter_cnt;
+      if (memchr (b, a[0], size) != NULL)
+        fail ("memset of %zu bytes is wrong", size);
+
+      a[size - 1] = '\0';
+      start = rdtsc ();
+      for (j = 0; j < iter_cnt; j++)
+        if (strlen ((char *) a) != size - 1)
+          fail ("strlen of %zu bytes is wrong", size);
+      len = (rdtsc () - start) / iter_cnt;
+      a[size - 1] = 'a' + (size - 1) % 26;
+
+      msg ("%5zu bytes: byte loop %llu, memcpy %llu, memcmp %llu, "
+           "memmove %llu, memset %llu, strlen %llu cycles.",
+           size, bytes, copy, cmp, move, set, len);
+    }
+
+  palloc_free_multiple (a, BUF_PAGES);
+  palloc_free_multiple (b, BUF_PAGES);
+  pass ();
+}
+
+/* Copies SIZE bytes from SRC to DST one at a time, as lib/string.c
+   used to. */
+static void
+byte_copy (uint8_t *dst, const uint8_t *src, size_t size)
+{
+  while (size-- > 0)
+    *dst++ = *src++;
+}
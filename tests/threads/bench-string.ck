@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The test checks each routine's results itself.  Cycle counts
+# vary from run to run, so check only that every size was
+# measured, in order.
+s/: byte loop \d+, memcpy \d+, memcmp \d+, memmove \d+, memset \d+, strlen \d+ cycles\.$/: byte loop #, memcpy #, memcmp #, memmove #, memset #, strlen # cycles./
+  foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-string) begin
+(bench-string)     8 bytes: byte loop #, memcpy #, memcmp #, memmove #, memset #, strlen # cycles.
+(bench-string)    64 bytes: byte loop #, memcpy #, memcmp #, memmove #, memset #, strlen # cycles.
+(bench-string)   512 bytes: byte loop #, memcpy #, memcmp #, memmove #, memset #, strlen # cycles.
+(bench-string)  4096 bytes: byte loop #, memcpy #, memcmp #, memmove #, memset #, strlen # cycles.
+(bench-string) 65536 bytes: byte loop #, memcpy #, memcmp #, memmove #, memset #, strlen # cycles.
+(bench-string) PASS
+(bench-string) end
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* Measures the cost of a thread switch.
+
+   Two threads of equal priority take turns through a pair of
+   semaphores, so every sema_down() blocks and hands the CPU to
+   the other thread.  Each round trip is two thread switches,
+   including the scheduler class's enqueue and pick_next calls and
+   the register save and restore.  The test reports the average
+   number of cycles per switch.
+
+   bench-switch runs this under the default round-robin scheduler
+   and bench-switch-cfs under the fair-share scheduler, so the
+   cost of the two scheduler classes can be compared. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define WARMUP_CNT 1000
+#define ROUND_TRIP_CNT 20000
+
+struct ping_pong
+  {
+    struct semaphore ping;
+    struct semaphore pong;
+    struct semaphore done;
+  };
+
+static thread_func pong_thread;
+
+void
+test_bench_switch (void)
+{
+  struct ping_pong pp;
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  sema_init (&pp.done, 0);
+  thread_create ("pong", thread_get_priority (), pong_thread, &pp);
+
+  for (i = 0; i < WARMUP_CNT; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < ROUND_TRIP_CNT; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+  cycles = rdtsc () - start;
+
+  sema_down (&pp.done);
+  msg ("%d round trips: %llu cycles per switch.",
+       ROUND_TRIP_CNT, cycles / (2 * ROUND_TRIP_CNT));
+  pass ();
+}
+
+static void
+pong_thread (void *pp_)
+{
+  struct ping_pong *pp = pp_;
+  int i;
+
+  for (i = 0; i < WARMUP_CNT + ROUND_TRIP_CNT; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+  sema_up (&pp->done);
+}
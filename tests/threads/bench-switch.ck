@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cycle count varies from run to run.
+s/: \d+ cycles per switch\.$/: # cycles per switch./ foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-switch) begin
+(bench-switch) 20000 round trips: # cycles per switch.
+(bench-switch) PASS
+(bench-switch) end
+EOF
+pass;
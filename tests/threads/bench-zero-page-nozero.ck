@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cycle count varies from run to run.
+s/: \d+ cycles each\.$/: # cycles each./ foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-zero-page-nozero) begin
+(bench-zero-page-nozero) 16 zeroed pages: 0 from the reserve.
+(bench-zero-page-nozero) 16 zeroed pages: # cycles each.
+(bench-zero-page-nozero) PASS
+(bench-zero-page-nozero) end
+EOF
+pass;
@@ -0,0 +1,65 @@
+/* Measures the cost of palloc_get_page(PAL_ZERO), which thread
+   creation, page table setup and anonymous page faults all pay.
+
+   The test asks for one zeroed page, so that the idle thread
+   starts keeping zeroed pages in reserve, and sleeps to give it
+   time to do so.  Then it times PAGE_CNT zeroed allocations in a
+   row and reports the average cost and how many came from the
+   reserve, checking that every page is in fact zeroed.  With the
+   reserve, which holds more than PAGE_CNT pages, all of them
+   should; without it, none.
+
+   bench-zero-page runs with the reserve and bench-zero-page-nozero
+   without it, so that the two can be compared. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define PAGE_CNT 16
+
+static void *pages[PAGE_CNT];
+
+void
+test_bench_zero_page (void)
+{
+  struct palloc_stats before, after;
+  uint64_t start, cycles = 0;
+  long long hits;
+  int i;
+
+  palloc_free_page (palloc_get_page (PAL_ZERO | PAL_ASSERT));
+  timer_sleep (10);
+
+  palloc_get_stats (0, &before);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      uint64_t *words;
+      size_t j;
+
+      start = rdtsc ();
+      pages[i] = palloc_get_page (PAL_ZERO | PAL_ASSERT);
+      cycles += rdtsc () - start;
+
+      words = pages[i];
+      for (j = 0; j < PGSIZE / sizeof *words; j++)
+        if (words[j] != 0)
+          fail ("page %d is not zeroed at byte %zu", i, j * sizeof *words);
+    }
+  palloc_get_stats (0, &after);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+
+  hits = after.zero_hits - before.zero_hits;
+  msg ("%d zeroed pages: %lld from the reserve.", PAGE_CNT, hits);
+  if (hits != (palloc_zero_pool ? PAGE_CNT : 0))
+    fail ("%lld pages should have come from the reserve",
+          palloc_zero_pool ? (long long) PAGE_CNT : 0LL);
+  msg ("%d zeroed pages: %llu cycles each.", PAGE_CNT, cycles / PAGE_CNT);
+  pass ();
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cycle count varies from run to run.
+s/: \d+ cycles each\.$/: # cycles each./ foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(bench-zero-page) begin
+(bench-zero-page) 16 zeroed pages: 16 from the reserve.
+(bench-zero-page) 16 zeroed pages: # cycles each.
+(bench-zero-page) PASS
+(bench-zero-page) end
+EOF
+pass;
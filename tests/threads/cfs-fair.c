@@ -0,0 +1,157 @@
+/* Measures how fairly the fair-share scheduler ("-cfs") divides
+   the CPU by nice value, and how promptly it wakes an interactive
+   thread that competes with CPU-bound threads.
+
+   Five CPU-bound threads with different nice values spin for
+   SPIN_SECS seconds, counting the timer ticks during which they
+   ran.  Each should receive a share of the ticks proportional to
+   its weight.  Meanwhile an interactive thread repeatedly sleeps
+   for one tick and records how late it woke up, which should stay
+   within the scheduler's target latency.
+
+   The test reports each thread's share next to the share its
+   weight calls for, and fails if they differ by more than a
+   quarter of the expected share plus one percentage point. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPIN_SECS 20
+#define LATENCY_LIMIT 8         /* Target latency of -cfs, in ticks. */
+
+/* Nice values of the CPU-bound threads and their weights, as
+   listed in the weight table in threads/thread.c. */
+static const int nices[] = {-5, 0, 0, 5, 10};
+static const int weights[] = {3121, 1024, 1024, 335, 110};
+#define THREAD_CNT ((int) (sizeof nices / sizeof *nices))
+
+struct thread_info
+  {
+    int64_t start_time;
+    int nice;
+    int tick_count;
+  };
+
+struct interactive_info
+  {
+    int64_t start_time;
+    int wakeups;
+    int64_t max_latency;
+  };
+
+static thread_func load_thread;
+static thread_func interactive_thread;
+
+void
+test_cfs_fair (void)
+{
+  struct thread_info info[THREAD_CNT];
+  struct interactive_info ii;
+  int64_t start_time;
+  int total_ticks, total_weight;
+  bool ok = true;
+  int i;
+
+  ASSERT (thread_cfs);
+
+  /* Keep the main thread ahead of the threads it creates. */
+  thread_set_nice (NICE_MIN);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d CPU-bound threads and 1 interactive thread...",
+       THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      info[i].start_time = start_time;
+      info[i].nice = nices[i];
+      info[i].tick_count = 0;
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, &info[i]);
+    }
+  ii.start_time = start_time;
+  ii.wakeups = 0;
+  ii.max_latency = 0;
+  thread_create ("interactive", PRI_DEFAULT, interactive_thread, &ii);
+
+  msg ("Sleeping %d seconds to let threads run, please wait...",
+       SPIN_SECS + 5);
+  timer_sleep ((SPIN_SECS + 5) * TIMER_FREQ);
+
+  total_ticks = total_weight = 0;
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      total_ticks += info[i].tick_count;
+      total_weight += weights[i];
+    }
+  if (total_ticks == 0)
+    fail ("CPU-bound threads received no ticks");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      /* Shares in tenths of a percent. */
+      int actual = info[i].tick_count * 1000 / total_ticks;
+      int expected = weights[i] * 1000 / total_weight;
+      int diff = actual > expected ? actual - expected : expected - actual;
+
+      msg ("Thread %d (nice %d): %d ticks, %d.%d%% of CPU, "
+           "expected %d.%d%%.", i, nices[i], info[i].tick_count,
+           actual / 10, actual % 10, expected / 10, expected % 10);
+      if (diff > expected / 4 + 10)
+        ok = false;
+    }
+  msg ("Interactive thread: %d wakeups, worst %"PRId64" ticks late.",
+       ii.wakeups, ii.max_latency);
+
+  if (!ok)
+    fail ("CPU shares differ too much from the weights");
+  if (ii.max_latency > LATENCY_LIMIT)
+    fail ("interactive thread woke up more than %d ticks late",
+          LATENCY_LIMIT);
+  pass ();
+}
+
+static void
+load_thread (void *ti_)
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 2 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + SPIN_SECS * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_nice (ti->nice);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time)
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
+
+static void
+interactive_thread (void *ii_)
+{
+  struct interactive_info *ii = ii_;
+  int64_t sleep_time = 2 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + SPIN_SECS * TIMER_FREQ;
+
+  timer_sleep (sleep_time - timer_elapsed (ii->start_time));
+  while (timer_elapsed (ii->start_time) < spin_time)
+    {
+      int64_t target = timer_ticks () + 1;
+      int64_t late;
+
+      timer_sleep (1);
+      late = timer_ticks () - target;
+      if (late > ii->max_latency)
+        ii->max_latency = late;
+      ii->wakeups++;
+    }
+}
@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The test itself fails if a share is too far from its weight or
+# a wakeup is too late.  Tick counts, shares and wakeups vary from
+# run to run, so mask them, but keep each expected share, which
+# depends only on the weights.
+local ($_);
+foreach (@output) {
+    s/: \d+ ticks, \d+\.\d% of CPU,/: # ticks, #% of CPU,/;
+    s/: \d+ wakeups, worst \d+ ticks late\.$/: # wakeups, worst # ticks late./;
+}
+
+compare_output ("run", \@output, [<<'EOF']);
+(cfs-fair) begin
+(cfs-fair) Starting 5 CPU-bound threads and 1 interactive thread...
+(cfs-fair) Sleeping 25 seconds to let threads run, please wait...
+(cfs-fair) Thread 0 (nice -5): # ticks, #% of CPU, expected 55.5%.
+(cfs-fair) Thread 1 (nice 0): # ticks, #% of CPU, expected 18.2%.
+(cfs-fair) Thread 2 (nice 0): # ticks, #% of CPU, expected 18.2%.
+(cfs-fair) Thread 3 (nice 5): # ticks, #% of CPU, expected 5.9%.
+(cfs-fair) Thread 4 (nice 10): # ticks, #% of CPU, expected 1.9%.
+(cfs-fair) Interactive thread: # wakeups, worst # ticks late.
+(cfs-fair) PASS
+(cfs-fair) end
+EOF
+pass;
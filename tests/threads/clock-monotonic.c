@@ -0,0 +1,80 @@
+/* Checks the TSC clocksource.
+
+   CLOCK_MONOTONIC must never go backward, must agree with the
+   timer tick to within a tick or so over a longer sleep, and a
+   sub-tick timer_usleep() must last at least as long as asked.
+   Sleeps of zero or negative length must return at once. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+#define READ_CNT 100000
+#define SLEEP_TICKS 50
+#define SPIN_US 500
+
+/* Nanoseconds per timer tick. */
+#define NSEC_PER_TICK (NSEC_PER_SEC / TIMER_FREQ)
+
+void
+test_clock_monotonic (void)
+{
+  struct timespec ts;
+  int64_t start_tick, ticks, ns;
+  uint64_t prev, now, start;
+  int i;
+
+  if (timer_gettime (CLOCK_MONOTONIC, &ts)
+      && ts.tv_nsec >= 0 && ts.tv_nsec < NSEC_PER_SEC)
+    msg ("clock_gettime: CLOCK_MONOTONIC supported.");
+  else
+    fail ("clock_gettime: CLOCK_MONOTONIC not supported.");
+  if (!timer_gettime (CLOCK_MONOTONIC + 1, &ts))
+    msg ("clock_gettime: other clocks refused.");
+  else
+    fail ("clock_gettime: accepted unknown clock.");
+
+  prev = timer_ns ();
+  for (i = 0; i < READ_CNT; i++)
+    {
+      now = timer_ns ();
+      if (now < prev)
+        fail ("clock went backward by %llu ns.", prev - now);
+      prev = now;
+    }
+  msg ("%d reads, never backward.", READ_CNT);
+
+  /* Start on a tick boundary. */
+  start_tick = timer_ticks ();
+  while (timer_ticks () == start_tick)
+    continue;
+  start_tick = timer_ticks ();
+  start = timer_ns ();
+  timer_sleep (SLEEP_TICKS);
+  ns = timer_ns () - start;
+  ticks = timer_ticks () - start_tick;
+  if (ns > (ticks - 2) * NSEC_PER_TICK && ns < (ticks + 2) * NSEC_PER_TICK)
+    msg ("Clock agrees with timer ticks.");
+  else
+    fail ("%lld ticks took %lld ns.", ticks, ns);
+
+  start = timer_ns ();
+  timer_usleep (SPIN_US);
+  ns = timer_ns () - start;
+  if (ns >= SPIN_US * 1000)
+    msg ("timer_usleep (%d) lasted long enough.", SPIN_US);
+  else
+    fail ("timer_usleep (%d) lasted %lld ns.", SPIN_US, ns);
+
+  start = timer_ns ();
+  timer_msleep (0);
+  timer_msleep (-1);
+  timer_usleep (-1000);
+  timer_nsleep (INT64_MIN);
+  ns = timer_ns () - start;
+  if (ns < NSEC_PER_TICK)
+    msg ("Zero and negative sleeps returned at once.");
+  else
+    fail ("Zero and negative sleeps took %lld ns.", ns);
+}
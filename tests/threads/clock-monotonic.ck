@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-monotonic) begin
+(clock-monotonic) clock_gettime: CLOCK_MONOTONIC supported.
+(clock-monotonic) clock_gettime: other clocks refused.
+(clock-monotonic) 100000 reads, never backward.
+(clock-monotonic) Clock agrees with timer ticks.
+(clock-monotonic) timer_usleep (500) lasted long enough.
+(clock-monotonic) Zero and negative sleeps returned at once.
+(clock-monotonic) end
+EOF
+pass;
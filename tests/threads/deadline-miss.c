@@ -0,0 +1,131 @@
+/* Checks that deadline threads meet their deadlines while
+   CPU-bound threads of the highest priority compete with them.
+
+   Three deadline threads reserve 60% of the CPU between them and
+   each run JOB_CNT periodic jobs, each job using a little less CPU
+   than its declared runtime.  A fourth reservation that would
+   push the total past the admission limit must be refused.
+   Meanwhile HOG_CNT threads at PRI_MAX spin for the whole test.
+   Earliest-deadline-first scheduling of the deadline threads
+   ahead of everything else should keep deadline misses at
+   zero. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define JOB_CNT 40
+#define HOG_CNT 4
+
+struct dl_info
+  {
+    int64_t runtime, deadline, period;
+    struct semaphore admitted;
+    struct semaphore done;
+    bool ok;
+    int misses;
+  };
+
+static thread_func dl_thread;
+static thread_func hog_thread;
+
+void
+test_deadline_miss (void)
+{
+  static const int64_t params[][3] = {{2, 5, 10}, {3, 12, 15}, {4, 16, 20}};
+  struct dl_info info[3];
+  int64_t hog_end;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  for (i = 0; i < 3; i++)
+    {
+      char name[16];
+
+      info[i].runtime = params[i][0];
+      info[i].deadline = params[i][1];
+      info[i].period = params[i][2];
+      sema_init (&info[i].admitted, 0);
+      sema_init (&info[i].done, 0);
+      snprintf (name, sizeof name, "dl %d", i);
+      thread_create (name, PRI_DEFAULT, dl_thread, &info[i]);
+    }
+  for (i = 0; i < 3; i++)
+    {
+      sema_down (&info[i].admitted);
+      if (!info[i].ok)
+        fail ("dl %d was refused admission", i);
+    }
+  msg ("Admitted 3 deadline threads.");
+
+  if (thread_set_deadline (4, 10, 10))
+    fail ("over-budget deadline thread was admitted");
+  msg ("Admission control rejected an over-budget thread.");
+
+  msg ("Starting %d CPU-bound threads at PRI_MAX.", HOG_CNT);
+  hog_end = timer_ticks () + (JOB_CNT * 20 + 200);
+  thread_set_priority (PRI_MAX);
+  for (i = 0; i < HOG_CNT; i++)
+    thread_create ("hog", PRI_MAX, hog_thread, &hog_end);
+  thread_set_priority (PRI_DEFAULT);
+
+  for (i = 0; i < 3; i++)
+    {
+      sema_down (&info[i].done);
+      msg ("dl %d: runtime %lld, deadline %lld, period %lld: %d misses.",
+           i, info[i].runtime, info[i].deadline, info[i].period,
+           info[i].misses);
+    }
+}
+
+/* Spins until the timer has ticked TICKS times. */
+static void
+spin_ticks (int ticks)
+{
+  int64_t last = timer_ticks ();
+
+  while (ticks > 0)
+    {
+      int64_t now = timer_ticks ();
+      if (now != last)
+        ticks--;
+      last = now;
+    }
+}
+
+static void
+dl_thread (void *info_)
+{
+  struct dl_info *info = info_;
+  int job;
+
+  info->ok = thread_set_deadline (info->runtime, info->deadline,
+                                  info->period);
+  sema_up (&info->admitted);
+  if (!info->ok)
+    return;
+
+  for (job = 0; job < JOB_CNT; job++)
+    {
+      spin_ticks (info->runtime - 1);
+      thread_deadline_yield ();
+    }
+
+  info->misses = thread_get_deadline_misses ();
+  thread_clear_deadline ();
+  sema_up (&info->done);
+}
+
+static void
+hog_thread (void *end_)
+{
+  int64_t *end = end_;
+
+  while (timer_ticks () < *end)
+    continue;
+}
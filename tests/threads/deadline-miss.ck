@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(deadline-miss) begin
+(deadline-miss) Admitted 3 deadline threads.
+(deadline-miss) Admission control rejected an over-budget thread.
+(deadline-miss) Starting 4 CPU-bound threads at PRI_MAX.
+(deadline-miss) dl 0: runtime 2, deadline 5, period 10: 0 misses.
+(deadline-miss) dl 1: runtime 3, deadline 12, period 15: 0 misses.
+(deadline-miss) dl 2: runtime 4, deadline 16, period 20: 0 misses.
+(deadline-miss) end
+EOF
+pass;
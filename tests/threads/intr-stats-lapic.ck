@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(intr-stats-lapic) begin
+(intr-stats-lapic) timer: at least 20 more interrupts.
+(intr-stats-lapic) timer: handler cycles charged.
+(intr-stats-lapic) timer: no nested interrupts.
+(intr-stats-lapic) end
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Checks the per-vector interrupt statistics.
+
+   Sleeping for twenty ticks should run the timer interrupt
+   handler at least twenty times and charge it some cycles.  The
+   timer interrupt cannot arrive while another handler runs with
+   interrupts off, so none of these runs should count as
+   nested. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+
+#define TIMER_VEC 0x20
+#define SLEEP_TICKS 20
+
+void
+test_intr_stats (void)
+{
+  struct intr_stats before, after;
+
+  intr_get_stats (TIMER_VEC, &before);
+  timer_sleep (SLEEP_TICKS);
+  intr_get_stats (TIMER_VEC, &after);
+
+  if (after.count - before.count >= SLEEP_TICKS)
+    msg ("timer: at least %d more interrupts.", SLEEP_TICKS);
+  else
+    fail ("timer: only %lld more interrupts.", after.count - before.count);
+
+  if (after.cycles > before.cycles && after.max_cycles > 0
+      && after.max_cycles <= after.cycles)
+    msg ("timer: handler cycles charged.");
+  else
+    fail ("timer: %lld cycles total, %lld max.",
+          after.cycles, after.max_cycles);
+
+  if (after.nested == before.nested)
+    msg ("timer: no nested interrupts.");
+  else
+    fail ("timer: %lld nested interrupts.", after.nested - before.nested);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(intr-stats) begin
+(intr-stats) timer: at least 20 more interrupts.
+(intr-stats) timer: handler cycles charged.
+(intr-stats) timer: no nested interrupts.
+(intr-stats) end
+EOF
+pass;
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ktimer-many-nohz) begin
+(ktimer-many-nohz) Arming 20000 timers.
+(ktimer-many-nohz) Cancelled 4000 timers.
+(ktimer-many-nohz) All 16000 armed timers fired once, on time.
+(ktimer-many-nohz) end
+EOF
+pass;
@@ -0,0 +1,110 @@
+/* Arms tens of thousands of kernel timers with scattered expiry
+   ticks, re-arms and cancels some of them, and verifies that
+   every timer still armed fires exactly once, on its expiry
+   tick, and that no cancelled timer fires. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "devices/ktimer.h"
+#include "devices/timer.h"
+
+#define TIMER_CNT 20000         /* Number of timers. */
+#define NEAR_TICKS 300          /* Timers expire within this many ticks. */
+#define FAR_TICKS 5000          /* Cancelled timers are this far out. */
+
+struct test_timer
+  {
+    struct ktimer timer;        /* Timer under test. */
+    bool cancelled;             /* Was this timer cancelled? */
+    int64_t fired_at;           /* Tick at which the callback ran. */
+    int fire_cnt;               /* Number of times the callback ran. */
+  };
+
+static ktimer_func fire;
+
+void
+test_ktimer_many (void)
+{
+  struct test_timer *timers;
+  enum intr_level old_level;
+  int64_t start;
+  int cancel_cnt = 0;
+  int i;
+
+  timers = calloc (TIMER_CNT, sizeof *timers);
+  if (timers == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  msg ("Arming %d timers.", TIMER_CNT);
+
+  /* Arm everything within one tick, so that no expiry tick passes
+     before its timer is in the wheel. */
+  old_level = intr_disable ();
+  start = timer_ticks ();
+  for (i = 0; i < TIMER_CNT; i++)
+    {
+      struct test_timer *t = &timers[i];
+
+      ktimer_init (&t->timer, fire, t);
+      if (i % 5 == 0)
+        {
+          /* Far out, then cancelled, to exercise the upper levels. */
+          ktimer_add (&t->timer,
+                      start + FAR_TICKS + random_ulong () % (1 << 20));
+          t->cancelled = true;
+        }
+      else
+        ktimer_add (&t->timer, start + 1 + random_ulong () % NEAR_TICKS);
+
+      if (i % 3 == 0)
+        ktimer_mod (&t->timer, t->timer.expires + random_ulong () % 64);
+    }
+  for (i = 0; i < TIMER_CNT; i++)
+    if (timers[i].cancelled)
+      {
+        if (!ktimer_cancel (&timers[i].timer))
+          fail ("timer %d was not pending when cancelled", i);
+        cancel_cnt++;
+      }
+  intr_set_level (old_level);
+
+  msg ("Cancelled %d timers.", cancel_cnt);
+
+  /* Wait for every remaining timer to expire. */
+  timer_sleep (NEAR_TICKS + 64 + 10);
+
+  for (i = 0; i < TIMER_CNT; i++)
+    {
+      struct test_timer *t = &timers[i];
+
+      if (t->cancelled)
+        {
+          if (t->fire_cnt != 0)
+            fail ("cancelled timer %d fired", i);
+        }
+      else if (t->fire_cnt != 1)
+        fail ("timer %d fired %d times", i, t->fire_cnt);
+      else if (t->fired_at != t->timer.expires)
+        fail ("timer %d fired at tick %lld, expected %lld",
+              i, t->fired_at - start, t->timer.expires - start);
+      else if (ktimer_pending (&t->timer))
+        fail ("timer %d still pending after firing", i);
+    }
+  msg ("All %d armed timers fired once, on time.", TIMER_CNT - cancel_cnt);
+
+  free (timers);
+}
+
+/* Timer callback. */
+static void
+fire (void *t_)
+{
+  struct test_timer *t = t_;
+
+  t->fired_at = timer_ticks ();
+  t->fire_cnt++;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ktimer-many) begin
+(ktimer-many) Arming 20000 timers.
+(ktimer-many) Cancelled 4000 timers.
+(ktimer-many) All 16000 armed timers fired once, on time.
+(ktimer-many) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Makes a lock contended and checks, in the shutdown statistics,
+   that -lockstat reported it.
+
+   The main thread holds a lock while a higher-priority thread
+   tries to acquire it, so that acquisition must wait. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/lockstat.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func contender_thread;
+
+void
+test_lockstat_contend (void)
+{
+  struct lock lock;
+
+  ASSERT (lockstat_enabled);
+
+  lock_init (&lock);
+  lock_acquire (&lock);
+  thread_create ("contender", PRI_DEFAULT + 1, contender_thread, &lock);
+  msg ("Releasing contended lock %p.", &lock);
+  lock_release (&lock);
+  msg ("Lock released.");
+  pass ();
+}
+
+static void
+contender_thread (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_release (lock);
+}
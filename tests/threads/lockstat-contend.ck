@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($lock) = map (/Releasing contended lock (\S+)\./, @output);
+fail "missing lock address in output" unless defined $lock;
+fail "lock not reported as contended"
+  unless grep (/^\s+lock \Q$lock\E from \S+: \d+ acquired, [1-9]\d* contended/,
+	       @output);
+
+# The lock's address depends on the stack layout.
+s/^(\(lockstat-contend\) Releasing contended lock) \S+\.$/$1 #./
+  foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(lockstat-contend) begin
+(lockstat-contend) Releasing contended lock #.
+(lockstat-contend) Lock released.
+(lockstat-contend) PASS
+(lockstat-contend) end
+EOF
+pass;
@@ -0,0 +1,109 @@
+/* Measures how much time the timer interrupt takes away from a
+   spinning thread under the MLFQS, as the number of threads in
+   the system grows.
+
+   The main thread spins reading the time-stamp counter.  A gap
+   between two consecutive reads that is much longer than one
+   iteration of the loop is time spent in the timer interrupt,
+   including thread_tick().  Gaps are reported separately for the
+   one tick per second that recomputes every thread's recent_cpu
+   and priority, and for all other ticks.  The cost of ordinary
+   ticks should not depend on the number of threads.
+
+   The extra threads are blocked on a semaphore, so they are part
+   of the once-per-second update without competing for the
+   CPU. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* A gap longer than this many cycles is taken to be an
+   interrupt. */
+#define GAP_CYCLES 1000
+
+/* Number of timer ticks to measure at each thread count. */
+#define SAMPLE_TICKS (TIMER_FREQ * 3)
+
+struct tick_cost
+  {
+    struct semaphore start;     /* Upped to release blocked threads. */
+    struct semaphore done;      /* Upped by each released thread. */
+  };
+
+static thread_func blocked_thread;
+
+static const int thread_cnts[] = {0, 50, 200, 800};
+
+void
+test_mlfqs_tick_cost (void)
+{
+  struct tick_cost tc;
+  size_t i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&tc.start, 0);
+  sema_init (&tc.done, 0);
+
+  for (i = 0; i < sizeof thread_cnts / sizeof *thread_cnts; i++)
+    {
+      uint64_t tick_cycles = 0, second_cycles = 0;
+      int tick_cnt = 0, second_cnt = 0;
+      uint64_t prev, now;
+      int created, j;
+
+      for (created = 0; created < thread_cnts[i]; created++)
+        if (thread_create ("blocked", PRI_DEFAULT, blocked_thread, &tc)
+            == TID_ERROR)
+          fail ("out of memory after %d threads", created);
+
+      /* Start measuring at the beginning of a tick. */
+      timer_sleep (1);
+
+      prev = rdtsc ();
+      while (tick_cnt + second_cnt < SAMPLE_TICKS)
+        {
+          now = rdtsc ();
+          if (now - prev > GAP_CYCLES)
+            {
+              if (timer_ticks () % TIMER_FREQ == 0)
+                {
+                  second_cycles += now - prev;
+                  second_cnt++;
+                }
+              else
+                {
+                  tick_cycles += now - prev;
+                  tick_cnt++;
+                }
+              now = rdtsc ();
+            }
+          prev = now;
+        }
+
+      msg ("%d threads: %llu cycles per tick, "
+           "%llu cycles per once-a-second tick.",
+           created + 2, tick_cycles / (tick_cnt > 0 ? tick_cnt : 1),
+           second_cycles / (second_cnt > 0 ? second_cnt : 1));
+
+      for (j = 0; j < created; j++)
+        sema_up (&tc.start);
+      for (j = 0; j < created; j++)
+        sema_down (&tc.done);
+    }
+  pass ();
+}
+
+static void
+blocked_thread (void *tc_)
+{
+  struct tick_cost *tc = tc_;
+
+  sema_down (&tc->start);
+  sema_up (&tc->done);
+}
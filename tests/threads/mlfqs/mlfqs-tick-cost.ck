@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts vary from run to run, so check only that every
+# thread count was measured, in order.
+s/: \d+ cycles per tick, \d+ cycles per once-a-second tick\.$/: # cycles per tick, # cycles per once-a-second tick./
+  foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(mlfqs-tick-cost) begin
+(mlfqs-tick-cost) 2 threads: # cycles per tick, # cycles per once-a-second tick.
+(mlfqs-tick-cost) 52 threads: # cycles per tick, # cycles per once-a-second tick.
+(mlfqs-tick-cost) 202 threads: # cycles per tick, # cycles per once-a-second tick.
+(mlfqs-tick-cost) 802 threads: # cycles per tick, # cycles per once-a-second tick.
+(mlfqs-tick-cost) PASS
+(mlfqs-tick-cost) end
+EOF
+pass;
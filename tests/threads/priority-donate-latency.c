@@ -0,0 +1,118 @@
+/* Measures how long a high-priority thread waits for a lock at
+   the end of a chain of lock holders, while CPU-bound threads of
+   intermediate priority compete for the CPU.
+
+   The main thread, at PRI_MIN, holds lock 0.  Each of threads
+   1...CHAIN_CNT - 1 acquires lock I and then waits for lock I - 1.
+   Finally a PRI_MAX thread starts HOG_CNT CPU-bound threads at
+   PRI_DEFAULT and waits for the last lock.  Only priority
+   donation along the whole chain lets the main thread and then
+   each link run ahead of the hogs, so the PRI_MAX thread gets its
+   lock after a few thread switches.  Without it, the chain would
+   not move until the hogs finished.  The test checks that the
+   locks were handed down the chain in order before any hog ran,
+   and reports the cycles from the PRI_MAX thread's lock_acquire()
+   call to its return.
+
+   The chain is as deep as in priority-donate-chain, which is
+   within the default donation depth. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define CHAIN_CNT 8
+#define HOG_CNT 4
+
+static struct lock locks[CHAIN_CNT];
+static struct semaphore done;
+static volatile bool finished;
+static uint64_t latency;
+
+/* Locks in the order they were acquired after the main thread
+   released lock 0, and # of hogs that had started by the time
+   the PRI_MAX thread got its lock. */
+static int acquired[CHAIN_CNT];
+static int acquired_cnt;
+static volatile int hogs_started;
+static int hogs_before;
+
+static thread_func link_thread, top_thread, hog_thread;
+
+void
+test_priority_donate_latency (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  for (i = 0; i < CHAIN_CNT; i++)
+    lock_init (&locks[i]);
+  thread_set_priority (PRI_MIN);
+
+  lock_acquire (&locks[0]);
+  for (i = 1; i < CHAIN_CNT; i++)
+    thread_create ("link", PRI_MIN + i, link_thread, &locks[i]);
+  thread_create ("top", PRI_MAX, top_thread, NULL);
+  lock_release (&locks[0]);
+
+  sema_down (&done);
+  for (i = 0; i < acquired_cnt; i++)
+    msg ("Lock %d acquired.", acquired[i]);
+  if (acquired_cnt != CHAIN_CNT)
+    fail ("only %d of %d locks acquired", acquired_cnt, CHAIN_CNT);
+  if (hogs_before != 0)
+    fail ("%d hog(s) ran before the last lock was acquired", hogs_before);
+  msg ("No hog ran before the last lock was acquired.");
+  msg ("Chain of %d locks: %llu cycles to acquire the last one.",
+       CHAIN_CNT, latency);
+  pass ();
+}
+
+/* Holds LOCK_ while waiting for the lock before it in the
+   chain. */
+static void
+link_thread (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_acquire (lock - 1);
+  acquired[acquired_cnt++] = lock - 1 - locks;
+  lock_release (lock - 1);
+  lock_release (lock);
+}
+
+static void
+top_thread (void *aux UNUSED)
+{
+  uint64_t start;
+  int i;
+
+  for (i = 0; i < HOG_CNT; i++)
+    thread_create ("hog", PRI_DEFAULT, hog_thread, NULL);
+
+  start = rdtsc ();
+  lock_acquire (&locks[CHAIN_CNT - 1]);
+  latency = rdtsc () - start;
+  hogs_before = hogs_started;
+  acquired[acquired_cnt++] = CHAIN_CNT - 1;
+  lock_release (&locks[CHAIN_CNT - 1]);
+
+  finished = true;
+  sema_up (&done);
+}
+
+/* Spins until the PRI_MAX thread has its lock. */
+static void
+hog_thread (void *aux UNUSED)
+{
+  hogs_started++;
+  while (!finished)
+    barrier ();
+}
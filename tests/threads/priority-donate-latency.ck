@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cycle count varies from run to run.
+s/: \d+ cycles to /: # cycles to / foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(priority-donate-latency) begin
+(priority-donate-latency) Lock 0 acquired.
+(priority-donate-latency) Lock 1 acquired.
+(priority-donate-latency) Lock 2 acquired.
+(priority-donate-latency) Lock 3 acquired.
+(priority-donate-latency) Lock 4 acquired.
+(priority-donate-latency) Lock 5 acquired.
+(priority-donate-latency) Lock 6 acquired.
+(priority-donate-latency) Lock 7 acquired.
+(priority-donate-latency) No hog ran before the last lock was acquired.
+(priority-donate-latency) Chain of 8 locks: # cycles to acquire the last one.
+(priority-donate-latency) PASS
+(priority-donate-latency) end
+EOF
+pass;
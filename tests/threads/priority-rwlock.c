@@ -0,0 +1,71 @@
+/* Tests that the threads waiting for a reader-writer lock donate
+   their priority to the writer that holds it, and that a released
+   reader-writer lock goes to the highest-priority waiting writer
+   first.  Waiting readers are all woken together and run in
+   order of priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread;
+static thread_func reader_thread;
+static struct rwlock rwlock;
+
+void
+test_priority_rwlock (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+
+  rwlock_write_acquire (&rwlock);
+  for (i = 0; i < 5; i++) 
+    {
+      int priority = PRI_DEFAULT + 1 + i * 3 % 5;
+      char name[16];
+      snprintf (name, sizeof name, "writer %d", priority);
+      thread_create (name, priority, writer_thread, NULL);
+      msg ("Main thread has priority %d.", thread_get_priority ());
+    }
+  msg ("Main thread releasing write lock.");
+  rwlock_write_release (&rwlock);
+  msg ("Main thread has priority %d.", thread_get_priority ());
+
+  rwlock_write_acquire (&rwlock);
+  for (i = 0; i < 3; i++) 
+    {
+      int priority = PRI_DEFAULT + 1 + (i + 1) % 3;
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", priority);
+      thread_create (name, priority, reader_thread, NULL);
+      msg ("Main thread has priority %d.", thread_get_priority ());
+    }
+  msg ("Main thread releasing write lock.");
+  rwlock_write_release (&rwlock);
+  msg ("Main thread has priority %d.", thread_get_priority ());
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_write_acquire (&rwlock);
+  msg ("Thread %s acquired the write lock.", thread_name ());
+  rwlock_write_release (&rwlock);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_read_acquire (&rwlock);
+  msg ("Thread %s acquired the read lock.", thread_name ());
+  rwlock_read_release (&rwlock);
+}
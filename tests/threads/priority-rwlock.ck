@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-rwlock) begin
+(priority-rwlock) Main thread has priority 32.
+(priority-rwlock) Main thread has priority 35.
+(priority-rwlock) Main thread has priority 35.
+(priority-rwlock) Main thread has priority 36.
+(priority-rwlock) Main thread has priority 36.
+(priority-rwlock) Main thread releasing write lock.
+(priority-rwlock) Thread writer 36 acquired the write lock.
+(priority-rwlock) Thread writer 35 acquired the write lock.
+(priority-rwlock) Thread writer 34 acquired the write lock.
+(priority-rwlock) Thread writer 33 acquired the write lock.
+(priority-rwlock) Thread writer 32 acquired the write lock.
+(priority-rwlock) Main thread has priority 31.
+(priority-rwlock) Main thread has priority 33.
+(priority-rwlock) Main thread has priority 34.
+(priority-rwlock) Main thread has priority 34.
+(priority-rwlock) Main thread releasing write lock.
+(priority-rwlock) Thread reader 34 acquired the read lock.
+(priority-rwlock) Thread reader 33 acquired the read lock.
+(priority-rwlock) Thread reader 32 acquired the read lock.
+(priority-rwlock) Main thread has priority 31.
+(priority-rwlock) end
+EOF
+pass;
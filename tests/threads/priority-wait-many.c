@@ -0,0 +1,112 @@
+/* Puts WAITER_CNT threads of mixed priorities to sleep on a
+   semaphore, then on a condition variable, and checks that they
+   are woken highest priority first, and in order of arrival among
+   equal priorities. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define WAITER_CNT 200
+
+struct waiter_info
+  {
+    int idx;                    /* Order of creation. */
+    int priority;               /* Priority. */
+  };
+
+static struct waiter_info waiters[WAITER_CNT];
+static struct waiter_info *woken[WAITER_CNT];
+static int woken_cnt;
+
+static struct semaphore sema;
+static struct lock lock;
+static struct condition cond;
+
+static thread_func sema_waiter, cond_waiter;
+static void create_waiters (thread_func *);
+static void check_order (const char *what);
+
+void
+test_priority_wait_many (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&sema, 0);
+  lock_init (&lock);
+  cond_init (&cond);
+  thread_set_priority (PRI_MIN);
+
+  create_waiters (sema_waiter);
+  for (i = 0; i < WAITER_CNT; i++)
+    sema_up (&sema);
+  check_order ("semaphore");
+
+  create_waiters (cond_waiter);
+  for (i = 0; i < WAITER_CNT; i++)
+    {
+      lock_acquire (&lock);
+      cond_signal (&cond, &lock);
+      lock_release (&lock);
+    }
+  check_order ("condition variable");
+}
+
+/* Creates WAITER_CNT threads running FUNC, with priorities in a
+   scrambled order.  Each preempts us at once and goes to sleep. */
+static void
+create_waiters (thread_func *func)
+{
+  int i;
+
+  woken_cnt = 0;
+  for (i = 0; i < WAITER_CNT; i++)
+    {
+      struct waiter_info *w = &waiters[i];
+      w->idx = i;
+      w->priority = PRI_DEFAULT + 1 + (i * 7) % (PRI_MAX - PRI_DEFAULT);
+      thread_create ("waiter", w->priority, func, w);
+    }
+}
+
+/* Checks that the waiters were woken in the right order. */
+static void
+check_order (const char *what)
+{
+  int i;
+
+  if (woken_cnt != WAITER_CNT)
+    fail ("%d of %d %s waiters woke up", woken_cnt, WAITER_CNT, what);
+  for (i = 1; i < WAITER_CNT; i++)
+    {
+      struct waiter_info *a = woken[i - 1];
+      struct waiter_info *b = woken[i];
+      if (a->priority < b->priority
+          || (a->priority == b->priority && a->idx > b->idx))
+        fail ("%s waiter %d (priority %d) woke before "
+              "waiter %d (priority %d)",
+              what, a->idx, a->priority, b->idx, b->priority);
+    }
+  msg ("%d %s waiters woke up in order.", WAITER_CNT, what);
+}
+
+static void
+sema_waiter (void *w)
+{
+  sema_down (&sema);
+  woken[woken_cnt++] = w;
+}
+
+static void
+cond_waiter (void *w)
+{
+  lock_acquire (&lock);
+  cond_wait (&cond, &lock);
+  woken[woken_cnt++] = w;
+  lock_release (&lock);
+}
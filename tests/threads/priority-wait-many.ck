@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-wait-many) begin
+(priority-wait-many) 200 semaphore waiters woke up in order.
+(priority-wait-many) 200 condition variable waiters woke up in order.
+(priority-wait-many) end
+EOF
+pass;
@@ -0,0 +1,112 @@
+/* Checks that an object cache packs objects of an awkward size
+   more tightly than malloc() would, honors the requested
+   alignment, runs the constructor once per object rather than
+   once per allocation, and gives its slabs back when they are
+   empty. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_MAGIC 0x0b1ec7
+
+/* A 72-byte object, which malloc() would put in a 128-byte
+   block. */
+struct obj
+  {
+    unsigned magic;
+    int users;
+    char data[64];
+  };
+
+static struct kmem_cache obj_cache;
+static struct kmem_cache aligned_cache;
+static int ctor_cnt;
+
+static kmem_ctor obj_ctor;
+
+#define SLAB_CNT 3
+#define MAX_OBJS (SLAB_CNT * PGSIZE / sizeof (struct obj))
+
+static struct obj *objs[MAX_OBJS];
+
+void
+test_slab_cache (void)
+{
+  size_t obj_cnt, i, j;
+  int ctors;
+
+  kmem_cache_init (&obj_cache, "slab-cache", sizeof (struct obj), 0,
+                   obj_ctor);
+  if (obj_cache.objs_per_slab * sizeof (struct obj) < PGSIZE * 7 / 8)
+    fail ("only %zu objects per slab", obj_cache.objs_per_slab);
+  msg ("Slab is at least 7/8 full.");
+
+  obj_cnt = SLAB_CNT * obj_cache.objs_per_slab;
+  for (i = 0; i < obj_cnt; i++)
+    {
+      objs[i] = kmem_cache_alloc (&obj_cache);
+      if (objs[i] == NULL)
+        fail ("allocation %zu failed", i);
+      if ((uintptr_t) objs[i] % sizeof (void *) != 0)
+        fail ("object %zu is misaligned", i);
+      if (objs[i]->magic != OBJ_MAGIC || objs[i]->users != 0)
+        fail ("object %zu was not constructed", i);
+      objs[i]->users++;
+    }
+  for (i = 0; i < obj_cnt; i++)
+    for (j = i + 1; j < obj_cnt; j++)
+      if (objs[i] == objs[j])
+        fail ("objects %zu and %zu are the same", i, j);
+  msg ("Allocated %d slabs of objects.", SLAB_CNT);
+  if (ctor_cnt != (int) obj_cnt)
+    fail ("%d constructor calls for %zu objects", ctor_cnt, obj_cnt);
+  msg ("Constructor ran once per object.");
+
+  /* Free everything, leaving each object constructed. */
+  for (i = 0; i < obj_cnt; i++)
+    {
+      objs[i]->users--;
+      kmem_cache_free (&obj_cache, objs[i]);
+    }
+  msg ("Freed all objects: %zu slab(s) kept.", obj_cache.slab_cnt);
+
+  /* The kept slab is reused without constructing anything. */
+  ctors = ctor_cnt;
+  for (i = 0; i < obj_cache.objs_per_slab; i++)
+    {
+      objs[i] = kmem_cache_alloc (&obj_cache);
+      if (objs[i]->magic != OBJ_MAGIC || objs[i]->users != 0)
+        fail ("object %zu lost its constructed state", i);
+    }
+  msg ("Reused slab: %d constructor calls.", ctor_cnt - ctors);
+  for (i = 0; i < obj_cache.objs_per_slab; i++)
+    kmem_cache_free (&obj_cache, objs[i]);
+
+  kmem_cache_shrink (&obj_cache);
+  msg ("Shrunk cache: %zu slab(s) kept.", obj_cache.slab_cnt);
+
+  kmem_cache_init (&aligned_cache, "slab-cache-aligned", 40, 64, NULL);
+  for (i = 0; i < aligned_cache.objs_per_slab; i++)
+    {
+      objs[i] = kmem_cache_alloc (&aligned_cache);
+      if ((uintptr_t) objs[i] % 64 != 0)
+        fail ("aligned object %zu is at %p", i, objs[i]);
+    }
+  for (i = 0; i < aligned_cache.objs_per_slab; i++)
+    kmem_cache_free (&aligned_cache, objs[i]);
+  kmem_cache_shrink (&aligned_cache);
+  msg ("Aligned objects are aligned.");
+}
+
+static void
+obj_ctor (void *obj_)
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  obj->users = 0;
+  ctor_cnt++;
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) Slab is at least 7/8 full.
+(slab-cache) Allocated 3 slabs of objects.
+(slab-cache) Constructor ran once per object.
+(slab-cache) Freed all objects: 1 slab(s) kept.
+(slab-cache) Reused slab: 0 constructor calls.
+(slab-cache) Shrunk cache: 0 slab(s) kept.
+(slab-cache) Aligned objects are aligned.
+(slab-cache) end
+EOF
+pass;
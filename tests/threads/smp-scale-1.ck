@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Every CPU must come online.  Throughput varies from run to run,
+# so mask it.
+s/ in \d+ ticks: \d+ units per second\.$/ in # ticks: # units per second./
+  foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(smp-scale-1) begin
+(smp-scale-1) 1 of 1 CPUs online.
+(smp-scale-1) 4 threads did 800 units of work in # ticks: # units per second.
+(smp-scale-1) PASS
+(smp-scale-1) end
+EOF
+pass;
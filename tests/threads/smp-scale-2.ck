@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Every CPU must come online.  Throughput varies from run to run,
+# so mask it.
+s/ in \d+ ticks: \d+ units per second\.$/ in # ticks: # units per second./
+  foreach @output;
+
+compare_output ("run", \@output, [<<'EOF']);
+(smp-scale-2) begin
+(smp-scale-2) 2 of 2 CPUs online.
+(smp-scale-2) 4 threads did 800 units of work in # ticks: # units per second.
+(smp-scale-2) PASS
+(smp-scale-2) end
+EOF
+pass;
@@ -0,0 +1,84 @@
+/* Measures how the throughput of CPU-bound threads scales with
+   the number of CPUs.
+
+   WORKER_CNT threads each do WORK_CNT units of busy work, and the
+   test reports how many CPUs are online and the total units of
+   work done per second of wall-clock time.  smp-scale-1,
+   smp-scale-2, and smp-scale-4 run the same test on a machine
+   with 1, 2, and 4 CPUs, so throughput should grow about in
+   proportion.  The workers are all created on the BSP, so the
+   test also fails unless each online CPU took some of them from
+   its run queue. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WORKER_CNT 4
+#define WORK_CNT 200
+#define SPIN_CNT 100000
+
+/* Whether each CPU did any of the work. */
+static bool worked[CPU_MAX];
+
+static thread_func worker_thread;
+
+void
+test_smp_scale (void)
+{
+  struct semaphore done;
+  int64_t start, ticks;
+  int online = 0;
+  int i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    if (cpus[i].online)
+      online++;
+  msg ("%d of %d CPUs online.", online, cpu_cnt);
+
+  sema_init (&done, 0);
+  start = timer_ticks ();
+  for (i = 0; i < WORKER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "worker %d", i);
+      thread_create (name, PRI_DEFAULT, worker_thread, &done);
+    }
+  for (i = 0; i < WORKER_CNT; i++)
+    sema_down (&done);
+  ticks = timer_elapsed (start);
+  if (ticks == 0)
+    ticks = 1;
+
+  msg ("%d threads did %d units of work in %lld ticks: "
+       "%lld units per second.",
+       WORKER_CNT, WORKER_CNT * WORK_CNT, ticks,
+       (long long) WORKER_CNT * WORK_CNT * TIMER_FREQ / ticks);
+
+  for (i = 0; i < cpu_cnt; i++)
+    if (cpus[i].online && !worked[i])
+      fail ("CPU %d did none of the work.", i);
+  pass ();
+}
+
+/* Does WORK_CNT units of busy work, noting the CPU that did each
+   one, then ups the semaphore DONE_. */
+static void
+worker_thread (void *done_)
+{
+  struct semaphore *done = done_;
+  volatile unsigned sum = 0;
+  int i, j;
+
+  for (i = 0; i < WORK_CNT; i++)
+    {
+      for (j = 0; j < SPIN_CNT; j++)
+        sum += j;
+      worked[cpu_current ()->id] = true;
+    }
+  sema_up (done);
+}
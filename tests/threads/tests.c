@@ -29,6 +29,34 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"bench-runqueue", test_bench_runqueue},
+    {"ktimer-many", test_ktimer_many},
+    {"cfs-fair", test_cfs_fair},
+    {"bench-switch", test_bench_switch},
+    {"bench-switch-cfs", test_bench_switch},
+    {"deadline-miss", test_deadline_miss},
+    {"bench-create", test_bench_create},
+    {"thread-stats", test_thread_stats},
+    {"lockstat-contend", test_lockstat_contend},
+    {"bench-rwlock", test_bench_rwlock},
+    {"priority-rwlock", test_priority_rwlock},
+    {"priority-wait-many", test_priority_wait_many},
+    {"priority-donate-latency", test_priority_donate_latency},
+    {"workqueue", test_workqueue},
+    {"intr-stats", test_intr_stats},
+    {"intr-stats-lapic", test_intr_stats},
+    {"alarm-multiple-nohz", test_alarm_multiple},
+    {"ktimer-many-nohz", test_ktimer_many},
+    {"clock-monotonic", test_clock_monotonic},
+    {"bench-palloc", test_bench_palloc},
+    {"slab-cache", test_slab_cache},
+    {"vmalloc-frag", test_vmalloc_frag},
+    {"bench-zero-page", test_bench_zero_page},
+    {"bench-zero-page-nozero", test_bench_zero_page},
+    {"bench-string", test_bench_string},
+    {"smp-scale-1", test_smp_scale},
+    {"smp-scale-2", test_smp_scale},
+    {"smp-scale-4", test_smp_scale},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +66,7 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-tick-cost", test_mlfqs_tick_cost},
   };
 
 static const char *test_name;
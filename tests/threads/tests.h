@@ -23,6 +23,27 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_bench_runqueue;
+extern test_func test_ktimer_many;
+extern test_func test_cfs_fair;
+extern test_func test_bench_switch;
+extern test_func test_deadline_miss;
+extern test_func test_bench_create;
+extern test_func test_thread_stats;
+extern test_func test_lockstat_contend;
+extern test_func test_bench_rwlock;
+extern test_func test_priority_rwlock;
+extern test_func test_priority_wait_many;
+extern test_func test_priority_donate_latency;
+extern test_func test_workqueue;
+extern test_func test_intr_stats;
+extern test_func test_clock_monotonic;
+extern test_func test_bench_palloc;
+extern test_func test_slab_cache;
+extern test_func test_vmalloc_frag;
+extern test_func test_bench_zero_page;
+extern test_func test_bench_string;
+extern test_func test_smp_scale;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +53,7 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_tick_cost;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,74 @@
+/* Checks the per-thread scheduling statistics.
+
+   One thread sleeps for a tick ten times, so it should record at
+   least ten voluntary switches and ten wakeups in its latency
+   histogram.  Another spins for ten ticks, so it should be
+   charged some run time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 10
+#define SPIN_TICKS 10
+
+static thread_func sleeper_thread, spinner_thread;
+
+void
+test_thread_stats (void)
+{
+  struct semaphore done;
+
+  sema_init (&done, 0);
+  thread_create ("sleeper", PRI_DEFAULT, sleeper_thread, &done);
+  sema_down (&done);
+  thread_create ("spinner", PRI_DEFAULT, spinner_thread, &done);
+  sema_down (&done);
+  pass ();
+}
+
+static void
+sleeper_thread (void *done_)
+{
+  struct semaphore *done = done_;
+  struct thread_stats stats;
+  int64_t wakeups = 0;
+  int i;
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    timer_sleep (1);
+
+  thread_get_stats (&stats);
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    wakeups += stats.latency[i];
+  if (stats.voluntary >= SLEEP_CNT)
+    msg ("sleeper: at least %d voluntary switches.", SLEEP_CNT);
+  else
+    msg ("sleeper: only %lld voluntary switches.", stats.voluntary);
+  if (wakeups >= SLEEP_CNT)
+    msg ("sleeper: at least %d wakeups.", SLEEP_CNT);
+  else
+    msg ("sleeper: only %lld wakeups.", wakeups);
+  sema_up (done);
+}
+
+static void
+spinner_thread (void *done_)
+{
+  struct semaphore *done = done_;
+  struct thread_stats stats;
+  int64_t start = timer_ticks ();
+
+  while (timer_elapsed (start) < SPIN_TICKS)
+    continue;
+
+  thread_get_stats (&stats);
+  if (stats.run_ticks > 0)
+    msg ("spinner: charged for its run time.");
+  else
+    msg ("spinner: no run ticks.");
+  sema_up (done);
+}
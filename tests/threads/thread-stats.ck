@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-stats) begin
+(thread-stats) sleeper: at least 10 voluntary switches.
+(thread-stats) sleeper: at least 10 wakeups.
+(thread-stats) spinner: charged for its run time.
+(thread-stats) end
+EOF
+pass;
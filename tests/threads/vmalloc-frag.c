@@ -0,0 +1,123 @@
+/* Fragments the kernel pool so that no two free pages are
+   adjacent, then checks that large tables can still be allocated
+   through vmalloc(), kvmalloc() and bitmap_create(), although
+   malloc() cannot find the contiguous pages it needs. */
+
+#include <bitmap.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "threads/vmalloc.h"
+
+#define TABLE_SIZE (64 * 1024)
+
+static void *fragment_pool (void);
+static void release_pool (void *pages);
+static void check_table (uint8_t *table, size_t size);
+
+void
+test_vmalloc_frag (void)
+{
+  struct bitmap *b;
+  void *held, *p;
+  size_t i;
+
+  held = fragment_pool ();
+  msg ("Fragmented kernel pool.");
+
+  p = malloc (TABLE_SIZE);
+  if (p != NULL)
+    fail ("malloc() found %d contiguous bytes", TABLE_SIZE);
+  msg ("malloc() failed, as expected.");
+
+  p = vmalloc (TABLE_SIZE);
+  if (p == NULL || !is_vmalloc_addr (p))
+    fail ("vmalloc() failed");
+  check_table (p, TABLE_SIZE);
+  vfree (p);
+  msg ("vmalloc() succeeded.");
+
+  p = kvmalloc (TABLE_SIZE);
+  if (p == NULL || !is_vmalloc_addr (p))
+    fail ("kvmalloc() did not fall back to vmalloc()");
+  check_table (p, TABLE_SIZE);
+  kvfree (p);
+  msg ("kvmalloc() fell back to vmalloc().");
+
+  b = bitmap_create (TABLE_SIZE * 8);
+  if (b == NULL)
+    fail ("bitmap_create() failed");
+  for (i = 0; i < TABLE_SIZE * 8; i += 3)
+    bitmap_mark (b, i);
+  if (bitmap_count (b, 0, TABLE_SIZE * 8, true) != (TABLE_SIZE * 8 + 2) / 3)
+    fail ("bitmap holds the wrong bits");
+  bitmap_destroy (b);
+  msg ("bitmap_create() succeeded.");
+
+  release_pool (held);
+  p = kvmalloc (TABLE_SIZE);
+  if (p == NULL || is_vmalloc_addr (p))
+    fail ("kvmalloc() did not use malloc() on an unfragmented pool");
+  kvfree (p);
+  msg ("kvmalloc() used malloc() after releasing the pool.");
+}
+
+/* Allocates every free page in the kernel pool, then frees the
+   odd-numbered ones, so that each free page is surrounded by
+   allocated ones.  Returns the pages still held, as a list
+   threaded through their first words. */
+static void *
+fragment_pool (void)
+{
+  void *all = NULL, *held = NULL;
+  void *page;
+
+  while ((page = palloc_get_page (0)) != NULL)
+    {
+      *(void **) page = all;
+      all = page;
+    }
+  while (all != NULL)
+    {
+      page = all;
+      all = *(void **) page;
+      if (pg_no (page) % 2)
+        palloc_free_page (page);
+      else
+        {
+          *(void **) page = held;
+          held = page;
+        }
+    }
+  return held;
+}
+
+/* Frees the list of PAGES returned by fragment_pool(). */
+static void
+release_pool (void *pages)
+{
+  while (pages != NULL)
+    {
+      void *next = *(void **) pages;
+      palloc_free_page (pages);
+      pages = next;
+    }
+}
+
+/* Fills the SIZE bytes of TABLE with a pattern and reads it
+   back, to check that every page is mapped to a page of its
+   own. */
+static void
+check_table (uint8_t *table, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    table[i] = i / PGSIZE + i;
+  for (i = 0; i < size; i++)
+    if (table[i] != (uint8_t) (i / PGSIZE + i))
+      fail ("byte %zu of table is corrupt", i);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(vmalloc-frag) begin
+(vmalloc-frag) Fragmented kernel pool.
+(vmalloc-frag) malloc() failed, as expected.
+(vmalloc-frag) vmalloc() succeeded.
+(vmalloc-frag) kvmalloc() fell back to vmalloc().
+(vmalloc-frag) bitmap_create() succeeded.
+(vmalloc-frag) kvmalloc() used malloc() after releasing the pool.
+(vmalloc-frag) end
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* Schedules deferred work from a thread and from a timer
+   interrupt, and verifies that each item runs once, in order, in
+   the worker thread for its priority. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/ktimer.h"
+#include "devices/timer.h"
+
+#define WORK_CNT 3
+
+static struct semaphore done;
+static struct work works[WORK_CNT];
+static struct work irq_work;
+static struct ktimer timer;
+
+static work_func run_work;
+static work_func run_irq_work;
+static ktimer_func schedule_irq_work;
+
+void
+test_workqueue (void)
+{
+  int i;
+
+  sema_init (&done, 0);
+
+  for (i = 0; i < WORK_CNT; i++)
+    work_init (&works[i], run_work, (void *) (uintptr_t) i);
+  for (i = 0; i < WORK_CNT; i++)
+    msg ("Scheduling work %d: %s.", i,
+         work_schedule (&works[i], WORK_NORMAL) ? "queued" : "refused");
+  msg ("Scheduling work 0 again: %s.",
+       work_schedule (&works[0], WORK_NORMAL) ? "queued" : "refused");
+  sema_down (&done);
+
+  work_init (&irq_work, run_irq_work, NULL);
+  ktimer_init (&timer, schedule_irq_work, NULL);
+  ktimer_add (&timer, timer_ticks () + 5);
+  sema_down (&done);
+  msg ("Done.");
+}
+
+static void
+run_work (void *aux)
+{
+  int i = (uintptr_t) aux;
+
+  msg ("Work %d ran in %s.", i, thread_name ());
+  if (i == WORK_CNT - 1)
+    sema_up (&done);
+}
+
+static void
+schedule_irq_work (void *aux UNUSED)
+{
+  ASSERT (intr_context ());
+  work_schedule (&irq_work, WORK_HIGH);
+}
+
+static void
+run_irq_work (void *aux UNUSED)
+{
+  msg ("Interrupt work ran in %s.", thread_name ());
+  sema_up (&done);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) Scheduling work 0: queued.
+(workqueue) Scheduling work 1: queued.
+(workqueue) Scheduling work 2: queued.
+(workqueue) Scheduling work 0 again: refused.
+(workqueue) Work 0 ran in kworker.
+(workqueue) Work 1 ran in kworker.
+(workqueue) Work 2 ran in kworker.
+(workqueue) Interrupt work ran in kworker-high.
+(workqueue) Done.
+(workqueue) end
+EOF
+pass;
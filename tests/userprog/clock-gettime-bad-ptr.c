@@ -0,0 +1,15 @@
+/* Passes an unmapped buffer to the clock_gettime system call,
+   which must cause the process to be terminated with exit code
+   -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  msg ("clock_gettime(CLOCK_MONOTONIC, 0x20101234): %d",
+       clock_gettime (CLOCK_MONOTONIC, (struct timespec *) 0x20101234));
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-gettime-bad-ptr) begin
+clock-gettime-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Reads CLOCK_MONOTONIC many times with the clock_gettime system
+   call and checks that every reading is well formed and no
+   earlier than the one before, then checks that an unsupported
+   clock is refused. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Number of readings to compare. */
+#define READ_CNT 1000
+
+void
+test_main (void) 
+{
+  struct timespec prev, ts;
+  int i;
+
+  CHECK (clock_gettime (CLOCK_MONOTONIC, &prev),
+         "clock_gettime(CLOCK_MONOTONIC)");
+  for (i = 0; i < READ_CNT; i++)
+    {
+      if (!clock_gettime (CLOCK_MONOTONIC, &ts))
+        fail ("clock_gettime failed on reading %d", i);
+      if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= NSEC_PER_SEC)
+        fail ("reading %d is %lld.%09lld, which is malformed", i,
+              (long long) ts.tv_sec, (long long) ts.tv_nsec);
+      if (ts.tv_sec < prev.tv_sec
+          || (ts.tv_sec == prev.tv_sec && ts.tv_nsec < prev.tv_nsec))
+        fail ("reading %d is %lld.%09lld, earlier than %lld.%09lld", i,
+              (long long) ts.tv_sec, (long long) ts.tv_nsec,
+              (long long) prev.tv_sec, (long long) prev.tv_nsec);
+      prev = ts;
+    }
+  msg ("%d readings never went backward", READ_CNT);
+
+  CHECK (!clock_gettime (CLOCK_MONOTONIC + 1, &ts),
+         "clock_gettime(unsupported clock) must fail");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-gettime) begin
+(clock-gettime) clock_gettime(CLOCK_MONOTONIC)
+(clock-gettime) 1000 readings never went backward
+(clock-gettime) clock_gettime(unsupported clock) must fail
+(clock-gettime) end
+clock-gettime: exit(0)
+EOF
+pass;
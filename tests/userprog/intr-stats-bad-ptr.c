@@ -0,0 +1,15 @@
+/* Passes a kernel address as the buffer for the intr_stats
+   system call, which must cause the process to be terminated
+   with exit code -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  msg ("get_intr_stats(0x20, 0x8004000000): %d",
+       get_intr_stats (0x20, (struct intr_stats *) 0x8004000000));
+  fail ("should have exited with -1");
+}
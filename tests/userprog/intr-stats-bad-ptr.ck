@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(intr-stats-bad-ptr) begin
+intr-stats-bad-ptr: exit(-1)
+EOF
+pass;
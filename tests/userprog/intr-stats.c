@@ -0,0 +1,33 @@
+/* Reads the timer interrupt's statistics twice with the
+   intr_stats system call and checks that they are consistent,
+   then checks that an invalid vector is refused. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Timer interrupt vector. */
+#define TIMER_VEC 0x20
+
+void
+test_main (void) 
+{
+  struct intr_stats before, after;
+
+  CHECK (get_intr_stats (TIMER_VEC, &before), "get_intr_stats(0x20)");
+  if (before.count <= 0)
+    fail ("timer interrupt count is %lld, should be positive",
+          (long long) before.count);
+  if (before.max_cycles > before.cycles)
+    fail ("longest run is longer than all runs together");
+  if (before.nested > before.count || before.yields > before.count)
+    fail ("more nested runs or yields than runs");
+
+  CHECK (get_intr_stats (TIMER_VEC, &after), "get_intr_stats(0x20) again");
+  if (after.count < before.count || after.cycles < before.cycles
+      || after.max_cycles < before.max_cycles)
+    fail ("counter went backward");
+
+  CHECK (!get_intr_stats (256, &after), "get_intr_stats(256) must fail");
+  CHECK (!get_intr_stats (-1, &after), "get_intr_stats(-1) must fail");
+}
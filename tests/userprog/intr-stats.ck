@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(intr-stats) begin
+(intr-stats) get_intr_stats(0x20)
+(intr-stats) get_intr_stats(0x20) again
+(intr-stats) get_intr_stats(256) must fail
+(intr-stats) get_intr_stats(-1) must fail
+(intr-stats) end
+intr-stats: exit(0)
+EOF
+pass;
@@ -0,0 +1,15 @@
+/* Passes an unmapped buffer to the thread_stats system call,
+   which must cause the process to be terminated with exit code
+   -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  msg ("get_thread_stats(0x20101234): %d",
+       get_thread_stats ((struct thread_stats *) 0x20101234));
+  fail ("should have exited with -1");
+}
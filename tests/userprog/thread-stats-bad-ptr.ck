@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-stats-bad-ptr) begin
+thread-stats-bad-ptr: exit(-1)
+EOF
+pass;
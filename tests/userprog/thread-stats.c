@@ -0,0 +1,32 @@
+/* Reads the process's scheduling statistics twice with the
+   thread_stats system call and checks that they are sane and
+   that no counter went backward in between. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct thread_stats before, after;
+  int i;
+
+  CHECK (get_thread_stats (&before), "get_thread_stats");
+  for (i = 0; i < 3; i++)
+    msg ("between reads %d", i);
+  CHECK (get_thread_stats (&after), "get_thread_stats again");
+
+  if (before.run_ticks < 0 || before.ready_ticks < 0
+      || before.voluntary < 0 || before.involuntary < 0)
+    fail ("negative counter in first read");
+  if (after.run_ticks < before.run_ticks
+      || after.ready_ticks < before.ready_ticks
+      || after.voluntary < before.voluntary
+      || after.involuntary < before.involuntary)
+    fail ("counter went backward");
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    if (after.latency[i] < before.latency[i])
+      fail ("latency bucket %d went backward", i);
+  msg ("counters never went backward");
+}
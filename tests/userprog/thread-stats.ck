@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-stats) begin
+(thread-stats) get_thread_stats
+(thread-stats) between reads 0
+(thread-stats) between reads 1
+(thread-stats) between reads 2
+(thread-stats) get_thread_stats again
+(thread-stats) counters never went backward
+(thread-stats) end
+thread-stats: exit(0)
+EOF
+pass;
@@ -0,0 +1,403 @@
+#include "threads/apic.h"
+#include <debug.h>
+#include <round.h>
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+/* Local APIC and I/O APIC interrupt controllers.
+
+   In APIC mode, which the "-apic" kernel command line option
+   selects, the 8259A PICs are masked and each ISA IRQ is routed
+   through the I/O APIC to the bootstrap processor's local APIC,
+   on the same vector 0x20 + IRQ that the PICs would use, so
+   handlers do not notice the difference.  The payoff is at the
+   end of each interrupt: the PICs need one or two port writes to
+   acknowledge it, but the local APIC needs just one write to a
+   memory-mapped register.  See [IA32-v3a] chapter 10 "Advanced
+   Programmable Interrupt Controller (APIC)" and [82093AA].
+
+   The local APIC also has a timer, which apic_timer_init() can
+   set up to replace the 8254 as the source of timer ticks.
+
+   Whether or not the ISA IRQs go through it, each CPU's local
+   APIC is also how the CPUs interrupt each other, with
+   interprocessor interrupts (IPIs).  The BSP starts each AP with
+   an INIT IPI and startup IPIs, and the scheduler sends IPIs to
+   wake up idle APs.  Each AP's local APIC timer drives its
+   scheduler; the ISA IRQs, including the 8254 that advances the
+   system tick, all go to the BSP. */
+
+/* Local APIC registers, as byte offsets. */
+#define LAPIC_TPR 0x080         /* Task priority. */
+#define LAPIC_EOI 0x0b0         /* End of interrupt. */
+#define LAPIC_SVR 0x0f0         /* Spurious interrupt vector. */
+#define LAPIC_LVT_TIMER 0x320   /* Local vector table: timer. */
+#define LAPIC_ICR_LO 0x300      /* Interrupt command, low half. */
+#define LAPIC_ICR_HI 0x310      /* Interrupt command, high half. */
+#define LAPIC_LVT_LINT0 0x350   /* Local vector table: LINT0 pin. */
+#define LAPIC_LVT_LINT1 0x360   /* Local vector table: LINT1 pin. */
+#define LAPIC_LVT_ERROR 0x370   /* Local vector table: errors. */
+#define LAPIC_TIMER_INIT 0x380  /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0   /* Timer divide configuration. */
+
+#define LAPIC_SVR_ENABLE 0x100  /* SVR: APIC software enable. */
+#define LVT_MASKED 0x10000      /* LVT: interrupt masked. */
+#define LVT_PERIODIC 0x20000    /* LVT_TIMER: periodic mode. */
+#define LVT_NMI 0x400           /* LVT: deliver as NMI. */
+#define LVT_EXTINT 0x700        /* LVT: deliver from the PICs. */
+#define TIMER_DIV_16 0x3        /* TIMER_DIV: divide bus clock by 16. */
+
+#define ICR_INIT 0x500          /* ICR: INIT IPI. */
+#define ICR_STARTUP 0x600       /* ICR: startup IPI. */
+#define ICR_PENDING 0x1000      /* ICR: not yet accepted. */
+#define ICR_ASSERT 0x4000       /* ICR: assert, for INIT. */
+#define ICR_LEVEL 0x8000        /* ICR: level triggered, for INIT. */
+
+/* Vector for spurious local APIC interrupts.  Its low four bits
+   must be set on older processors. */
+#define SPURIOUS_VEC 0xff
+
+/* I/O APIC registers.  Each is read or written by selecting it
+   in IOREGSEL and then accessing IOWIN. */
+#define IOAPIC_IOREGSEL 0x00    /* Register select, byte offset. */
+#define IOAPIC_IOWIN 0x10       /* Data window, byte offset. */
+#define IOAPIC_VER 0x01         /* Version and pin count. */
+#define IOAPIC_REDTBL 0x10      /* Redirection table, 2 per pin. */
+
+#define REDIR_ACTIVE_LOW 0x2000 /* Redirection: active low. */
+#define REDIR_LEVEL 0x8000      /* Redirection: level triggered. */
+#define REDIR_MASKED 0x10000    /* Redirection: masked. */
+
+/* Polarity and trigger mode fields of MP interrupt flags
+   [MP 4.3.4]. */
+#define MP_POLARITY(F) ((F) & 0x3)
+#define MP_TRIGGER(F) (((F) >> 2) & 0x3)
+#define MP_ACTIVE_LOW 0x3
+#define MP_LEVEL 0x3
+
+/* The local APIC timer is calibrated over 1/CALIBRATE_HZ s. */
+#define CALIBRATE_HZ 100        /* 10 ms. */
+
+static volatile uint32_t *lapic;        /* Local APIC registers. */
+static volatile uint32_t *ioapic;       /* I/O APIC registers. */
+
+/* Local APIC timer, once apic_timer_init() has started it. */
+static uint8_t timer_vec;               /* Interrupt vector. */
+static uint32_t timer_period;           /* Initial count per period. */
+
+/* Initial count of the APs' local APIC timers, for TIMER_FREQ
+   interrupts per second.  Set by apic_smp_init(). */
+static uint32_t ap_period;
+
+static intr_handler_func spurious_interrupt;
+static uint32_t timer_calibrate (unsigned freq);
+static void send_icr (uint8_t apic_id, uint32_t icr);
+static void delay_us (unsigned us);
+
+/* Returns local APIC register REG. */
+static uint32_t
+lapic_read (unsigned reg) {
+	return lapic[reg / 4];
+}
+
+/* Sets local APIC register REG to VALUE. */
+static void
+lapic_write (unsigned reg, uint32_t value) {
+	lapic[reg / 4] = value;
+}
+
+/* Returns I/O APIC register REG. */
+static uint32_t
+ioapic_read (unsigned reg) {
+	ioapic[IOAPIC_IOREGSEL / 4] = reg;
+	return ioapic[IOAPIC_IOWIN / 4];
+}
+
+/* Sets I/O APIC register REG to VALUE. */
+static void
+ioapic_write (unsigned reg, uint32_t value) {
+	ioapic[IOAPIC_IOREGSEL / 4] = reg;
+	ioapic[IOAPIC_IOWIN / 4] = value;
+}
+
+/* Maps the page of device registers at physical address PA into
+   the kernel's address space, uncached, and returns its kernel
+   virtual address.  Device registers lie above the RAM that
+   paging_init() maps, at the same offset from KERN_BASE. */
+static volatile uint32_t *
+map_mmio (uint64_t pa) {
+	uint64_t va = (uint64_t) ptov (pa);
+	uint64_t *pte = pml4e_walk (base_pml4, va, 1);
+
+	if (pte == NULL)
+		PANIC ("could not map device registers at %#llx", pa);
+	*pte = pa | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+	invlpg (va);
+	return (volatile uint32_t *) va;
+}
+
+/* Switches interrupt delivery from the 8259A PICs to the local
+   and I/O APICs, if the machine has both.  Returns true if
+   successful, false if it should keep using the PICs.  The PICs
+   must already be initialized, so that their spurious interrupts
+   land on harmless vectors, and interrupts must be off. */
+bool
+apic_init (void) {
+	uint32_t redir_cnt;
+	int irq, pin;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (lapic_base == 0 || ioapic_base == 0)
+		return false;
+	lapic = map_mmio (lapic_base);
+	ioapic = map_mmio (ioapic_base);
+
+	/* Route external interrupts to the APIC instead of straight to
+	   the CPU [MP 3.6.2.1]. */
+	if (imcr_present) {
+		outb (0x22, 0x70);
+		outb (0x23, inb (0x23) | 0x01);
+	}
+
+	/* Enable the local APIC.  LINT0 carries the PICs' interrupts
+	   in virtual wire mode, which we no longer use. */
+	lapic_write (LAPIC_SVR, LAPIC_SVR_ENABLE | SPURIOUS_VEC);
+	lapic_write (LAPIC_LVT_TIMER, LVT_MASKED);
+	lapic_write (LAPIC_LVT_LINT0, LVT_MASKED);
+	lapic_write (LAPIC_LVT_ERROR, LVT_MASKED);
+	lapic_write (LAPIC_TPR, 0);
+
+	/* Mask every I/O APIC pin, then route each ISA IRQ to the
+	   bootstrap processor.  IRQ 2 is the PICs' cascade and never
+	   fires, and it often shares a pin with IRQ 0. */
+	redir_cnt = ((ioapic_read (IOAPIC_VER) >> 16) & 0xff) + 1;
+	for (pin = 0; pin < (int) redir_cnt; pin++) {
+		ioapic_write (IOAPIC_REDTBL + 2 * pin, REDIR_MASKED);
+		ioapic_write (IOAPIC_REDTBL + 2 * pin + 1, 0);
+	}
+	for (irq = 0; irq < ISA_IRQ_CNT; irq++) {
+		uint16_t flags = isa_irq_flags[irq];
+		uint32_t redir = 0x20 + irq;
+
+		if (irq == 2 || isa_irq_pin[irq] >= redir_cnt)
+			continue;
+		if (MP_POLARITY (flags) == MP_ACTIVE_LOW)
+			redir |= REDIR_ACTIVE_LOW;
+		if (MP_TRIGGER (flags) == MP_LEVEL)
+			redir |= REDIR_LEVEL;
+		pin = isa_irq_pin[irq];
+		ioapic_write (IOAPIC_REDTBL + 2 * pin + 1,
+				(uint32_t) cpus[0].apic_id << 24);
+		ioapic_write (IOAPIC_REDTBL + 2 * pin, redir);
+	}
+
+	intr_register_int (SPURIOUS_VEC, 0, INTR_OFF, spurious_interrupt,
+			"APIC Spurious Interrupt");
+	apic_eoi ();
+	return true;
+}
+
+/* Acknowledges the interrupt being handled. */
+void
+apic_eoi (void) {
+	lapic_write (LAPIC_EOI, 0);
+}
+
+/* Masks ISA IRQ at the I/O APIC if MASKED is true, otherwise
+   unmasks it. */
+void
+apic_mask_irq (int irq, bool masked) {
+	unsigned reg;
+	uint32_t redir;
+
+	ASSERT (ioapic != NULL);
+	ASSERT (irq >= 0 && irq < ISA_IRQ_CNT);
+
+	reg = IOAPIC_REDTBL + 2 * isa_irq_pin[irq];
+	redir = ioapic_read (reg);
+	ioapic_write (reg, masked ? redir | REDIR_MASKED : redir & ~REDIR_MASKED);
+}
+
+/* Starts the local APIC timer raising interrupt VEC FREQ times
+   per second.  Returns false if the APIC is not in use.
+
+   The timer counts down at the bus clock rate, which nothing
+   tells us, so we first time how far it counts in CALIBRATE_HZ'th
+   of a second by the TSC, which timer_init() has calibrated. */
+bool
+apic_timer_init (uint8_t vec, unsigned freq) {
+	enum intr_level old_level;
+
+	if (lapic == NULL)
+		return false;
+
+	old_level = intr_disable ();
+	timer_vec = vec;
+	timer_period = timer_calibrate (freq);
+	apic_timer_periodic ();
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Returns the local APIC timer's initial count for FREQ
+   interrupts per second, as measured on the running CPU's timer,
+   which is left masked.  Interrupts must be off. */
+static uint32_t
+timer_calibrate (unsigned freq) {
+	uint64_t start, cycles = timer_tsc_hz () / CALIBRATE_HZ;
+	uint32_t counted;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (freq > 0);
+	ASSERT (cycles > 0);
+
+	lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+	lapic_write (LAPIC_LVT_TIMER, LVT_MASKED);
+	lapic_write (LAPIC_TIMER_INIT, UINT32_MAX);
+	start = rdtsc ();
+	while (rdtsc () - start < cycles)
+		continue;
+	counted = UINT32_MAX - lapic_read (LAPIC_TIMER_CUR);
+	return (uint64_t) counted * CALIBRATE_HZ / freq;
+}
+
+/* Makes the local APIC timer interrupt every period again, with
+   the first interrupt one period from now. */
+void
+apic_timer_periodic (void) {
+	ASSERT (timer_period != 0);
+
+	lapic_write (LAPIC_LVT_TIMER, timer_vec | LVT_PERIODIC);
+	lapic_write (LAPIC_TIMER_INIT, timer_period);
+}
+
+/* Makes the local APIC timer interrupt just once, NUM/DENOM of a
+   period from now, instead of every period. */
+void
+apic_timer_oneshot (uint64_t num, uint64_t denom) {
+	uint64_t count = DIV_ROUND_UP (num * timer_period, denom);
+
+	ASSERT (timer_period != 0);
+
+	if (count == 0)
+		count = 1;
+	else if (count > UINT32_MAX)
+		count = UINT32_MAX;
+	lapic_write (LAPIC_LVT_TIMER, timer_vec);
+	lapic_write (LAPIC_TIMER_INIT, count);
+}
+
+/* Prepares the BSP's local APIC for starting the APs and for
+   sending them IPIs, and works out the period of their timers.
+   Returns false if there is no local APIC.
+
+   In APIC mode, apic_init() has already done most of this.  With
+   the PICs, the local APIC is only enabled here, with LINT0 left
+   passing the PICs' interrupts through in virtual wire mode. */
+bool
+apic_smp_init (void) {
+	enum intr_level old_level;
+
+	if (lapic_base == 0)
+		return false;
+
+	old_level = intr_disable ();
+	if (lapic == NULL) {
+		lapic = map_mmio (lapic_base);
+		lapic_write (LAPIC_SVR, LAPIC_SVR_ENABLE | SPURIOUS_VEC);
+		lapic_write (LAPIC_LVT_LINT0, LVT_EXTINT);
+		lapic_write (LAPIC_LVT_LINT1, LVT_NMI);
+		lapic_write (LAPIC_LVT_ERROR, LVT_MASKED);
+		lapic_write (LAPIC_TPR, 0);
+		intr_register_int (SPURIOUS_VEC, 0, INTR_OFF, spurious_interrupt,
+				"APIC Spurious Interrupt");
+	}
+	ap_period = timer_period != 0 ? timer_period
+		: timer_calibrate (TIMER_FREQ);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Sets up the running AP's local APIC: enables it, masks its
+   local interrupt pins, which only the BSP's use, and starts its
+   timer raising LAPIC_TIMER_VEC TIMER_FREQ times per second.
+   Interrupts must be off. */
+void
+apic_init_ap (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (ap_period != 0);
+
+	lapic_write (LAPIC_SVR, LAPIC_SVR_ENABLE | SPURIOUS_VEC);
+	lapic_write (LAPIC_LVT_LINT0, LVT_MASKED);
+	lapic_write (LAPIC_LVT_LINT1, LVT_MASKED);
+	lapic_write (LAPIC_LVT_ERROR, LVT_MASKED);
+	lapic_write (LAPIC_TPR, 0);
+	lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+	lapic_write (LAPIC_LVT_TIMER, LAPIC_TIMER_VEC | LVT_PERIODIC);
+	lapic_write (LAPIC_TIMER_INIT, ap_period);
+}
+
+/* Starts the AP whose local APIC ID is APIC_ID running in real
+   mode at physical address PA, which must be page-aligned and
+   below 1 MB, following the INIT-SIPI-SIPI sequence of
+   [MP B.4].  Interrupts must be on, since this takes over 10 ms. */
+void
+apic_start_ap (uint8_t apic_id, uint64_t pa) {
+	int i;
+
+	ASSERT (lapic != NULL);
+	ASSERT (pa % PGSIZE == 0 && pa < 0x100000);
+
+	send_icr (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+	delay_us (200);
+	send_icr (apic_id, ICR_INIT | ICR_LEVEL);
+	delay_us (10000);
+	for (i = 0; i < 2; i++) {
+		send_icr (apic_id, ICR_STARTUP | (pa >> 12));
+		delay_us (200);
+	}
+}
+
+/* Sends interrupt VEC to the CPU whose local APIC ID is APIC_ID. */
+void
+apic_send_ipi (uint8_t apic_id, uint8_t vec) {
+	ASSERT (lapic != NULL);
+	send_icr (apic_id, vec);
+}
+
+/* Sends the IPI described by ICR to the CPU whose local APIC ID
+   is APIC_ID, and waits until its local APIC accepts it. */
+static void
+send_icr (uint8_t apic_id, uint32_t icr) {
+	enum intr_level old_level = intr_disable ();
+
+	lapic_write (LAPIC_ICR_HI, (uint32_t) apic_id << 24);
+	lapic_write (LAPIC_ICR_LO, icr);
+	while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+		continue;
+	intr_set_level (old_level);
+}
+
+/* Busy-waits for US microseconds, by the TSC. */
+static void
+delay_us (unsigned us) {
+	uint64_t start = rdtsc ();
+	uint64_t cycles = timer_tsc_hz () * us / 1000000;
+
+	while (rdtsc () - start < cycles)
+		continue;
+}
+
+/* Spurious local APIC interrupts need no acknowledgement. */
+static void
+spurious_interrupt (struct intr_frame *f UNUSED) {
+}
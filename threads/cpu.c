@@ -0,0 +1,477 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/apic.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#endif
+
+/* CPU enumeration.
+
+   The BIOS describes the machine's processors in the MultiProcessor
+   Specification tables [MP].  We find the MP floating pointer
+   structure, walk the configuration table it points to, and record
+   one struct cpu for each enabled processor.  If there are no MP
+   tables, the machine is a uniprocessor.
+
+   The bootstrap processor (BSP) is the one that booted the kernel.
+   Once it runs threads, cpu_start_aps() starts the application
+   processors (APs), which the BIOS left halted, one at a time
+   with an INIT-SIPI-SIPI sequence through the local APIC.  Each
+   AP comes up through the trampoline in threads/start.S on the
+   stack of an idle thread that the BSP made for it, sets up its
+   own descriptor tables and local APIC timer in cpu_ap_main(),
+   and then takes threads from the run queues like the BSP.  The
+   kernel's own data is protected by the big kernel lock, which
+   turning off interrupts acquires (see threads/interrupt.c).
+
+   The MP tables also describe the I/O APIC and which of its input
+   pins each ISA IRQ is wired to, which threads/apic.c needs to
+   route device interrupts through it. */
+
+struct cpu cpus[CPU_MAX];
+int cpu_cnt;
+int cpu_online_cnt;
+
+/* Set once the first AP is started.  Until then the BSP is the
+   only CPU running. */
+static bool aps_started;
+
+/* Generation of the kernel page tables, advanced by
+   cpu_flush_tlbs() whenever kernel mappings are removed.  A CPU
+   whose `tlb_gen' is behind may still have removed mappings in
+   its TLB, so it flushes its TLB as it takes the kernel lock (see
+   threads/interrupt.c). */
+unsigned long tlb_gen;
+
+/* The page tables and the stack for the AP being started, which
+   ap_entry in threads/start.S loads. */
+uint64_t ap_pml4;
+void *ap_stack;
+
+/* Longest to wait for an AP to start. */
+#define AP_TIMEOUT_NS 1000000000
+
+static intr_handler_func resched_interrupt;
+
+/* Physical address of the local APIC registers, or 0 if the CPU
+   has no local APIC. */
+uint64_t lapic_base;
+
+/* Physical address of the first I/O APIC's registers and its ID,
+   or 0 if the MP tables list none. */
+uint64_t ioapic_base;
+uint8_t ioapic_id;
+
+/* The I/O APIC input pin for each ISA IRQ and its polarity and
+   trigger mode flags, as in the MP interrupt entry.  ISA IRQ N is
+   on pin N, conforming to the bus, unless an MP interrupt entry
+   says otherwise. */
+uint8_t isa_irq_pin[ISA_IRQ_CNT];
+uint16_t isa_irq_flags[ISA_IRQ_CNT];
+
+/* True if the machine has an interrupt mode configuration register
+   that must be switched before I/O APIC interrupts reach the local
+   APIC [MP 3.6.2.1]. */
+bool imcr_present;
+
+/* MP floating pointer structure [MP 4.1]. */
+struct mp_fps {
+	char signature[4];          /* "_MP_". */
+	uint32_t config;            /* Physical address of config table. */
+	uint8_t length;             /* Length in 16-byte units. */
+	uint8_t revision;           /* Spec revision. */
+	uint8_t checksum;           /* All bytes must add up to 0. */
+	uint8_t type;               /* Default configuration, if no table. */
+	uint8_t features[4];
+} __attribute__ ((packed));
+
+/* MP configuration table header [MP 4.2]. */
+struct mp_config {
+	char signature[4];          /* "PCMP". */
+	uint16_t length;            /* Base table length. */
+	uint8_t revision;           /* Spec revision. */
+	uint8_t checksum;           /* All bytes must add up to 0. */
+	char oem_id[8];
+	char product_id[12];
+	uint32_t oem_table;
+	uint16_t oem_length;
+	uint16_t entry_cnt;         /* # of entries that follow. */
+	uint32_t lapic_addr;        /* Local APIC address. */
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__ ((packed));
+
+/* MP configuration table processor entry [MP 4.3.1].  All other
+   entry types are 8 bytes long. */
+struct mp_proc {
+	uint8_t type;               /* MP_PROC. */
+	uint8_t apic_id;            /* Local APIC ID. */
+	uint8_t apic_version;
+	uint8_t flags;              /* MP_PROC_*. */
+	uint32_t signature;
+	uint32_t features;
+	uint32_t reserved[2];
+} __attribute__ ((packed));
+
+#define MP_PROC 0               /* Processor entry type. */
+#define MP_PROC_EN 0x01         /* Processor is usable. */
+#define MP_PROC_BP 0x02         /* Processor is the BSP. */
+
+/* MP configuration table bus entry [MP 4.3.2]. */
+struct mp_bus {
+	uint8_t type;               /* MP_BUS. */
+	uint8_t bus_id;
+	char bus_type[6];           /* "ISA   ", "PCI   ", ... */
+} __attribute__ ((packed));
+
+/* MP configuration table I/O APIC entry [MP 4.3.3]. */
+struct mp_ioapic {
+	uint8_t type;               /* MP_IOAPIC. */
+	uint8_t apic_id;
+	uint8_t apic_version;
+	uint8_t flags;              /* MP_IOAPIC_EN. */
+	uint32_t addr;              /* Physical address of registers. */
+} __attribute__ ((packed));
+
+/* MP configuration table I/O interrupt entry [MP 4.3.4]. */
+struct mp_irq {
+	uint8_t type;               /* MP_IRQ. */
+	uint8_t irq_type;           /* MP_IRQ_INT for a vectored interrupt. */
+	uint16_t flags;             /* Polarity and trigger mode. */
+	uint8_t src_bus;            /* Bus ID of source. */
+	uint8_t src_irq;            /* IRQ on that bus. */
+	uint8_t dst_apic;           /* Destination I/O APIC ID. */
+	uint8_t dst_pin;            /* Input pin on that I/O APIC. */
+} __attribute__ ((packed));
+
+#define MP_BUS 1                /* Bus entry type. */
+#define MP_IOAPIC 2             /* I/O APIC entry type. */
+#define MP_IOAPIC_EN 0x01       /* I/O APIC is usable. */
+#define MP_IRQ 3                /* I/O interrupt entry type. */
+#define MP_IRQ_INT 0            /* Vectored interrupt. */
+#define MP_IMCRP 0x80           /* features[1] flag for an IMCR. */
+
+/* Most bus IDs that the MP tables may use. */
+#define MP_BUS_CNT 256
+
+#define MSR_APIC_BASE 0x1b      /* IA32_APIC_BASE MSR. */
+#define CPUID_APIC (1 << 9)     /* CPUID.1:EDX flag for a local APIC. */
+
+static void add_cpu (uint8_t apic_id, bool bsp);
+static void add_irq (const struct mp_irq *, const bool isa_bus[]);
+
+/* Returns true if the LEN bytes at P add up to 0. */
+static bool
+checksum_ok (const void *p, size_t len) {
+	const uint8_t *b = p;
+	uint8_t sum = 0;
+
+	while (len-- > 0)
+		sum += *b++;
+	return sum == 0;
+}
+
+/* Looks for the MP floating pointer structure in the LEN bytes at
+   physical address PA. */
+static struct mp_fps *
+mp_search_range (uint64_t pa, size_t len) {
+	uint8_t *p = ptov (pa);
+	uint8_t *end = p + len;
+
+	for (; p + sizeof (struct mp_fps) <= end; p += 16)
+		if (!memcmp (p, "_MP_", 4) && checksum_ok (p, sizeof (struct mp_fps)))
+			return (struct mp_fps *) p;
+	return NULL;
+}
+
+/* Looks for the MP floating pointer structure where [MP 4] says it
+   may be: in the first kB of the extended BIOS data area, in the
+   last kB of base memory, or in the BIOS ROM. */
+static struct mp_fps *
+mp_search (void) {
+	uint64_t ebda = (uint64_t) *(uint16_t *) ptov (0x40e) << 4;
+	uint64_t base_kb = *(uint16_t *) ptov (0x413);
+	struct mp_fps *fps;
+
+	if (ebda != 0 && (fps = mp_search_range (ebda, 1024)) != NULL)
+		return fps;
+	if (base_kb >= 1
+			&& (fps = mp_search_range ((base_kb - 1) * 1024, 1024)) != NULL)
+		return fps;
+	return mp_search_range (0xf0000, 0x10000);
+}
+
+/* Finds the local APIC and the I/O APIC, and enumerates the
+   CPUs. */
+void
+cpu_init (void) {
+	static bool isa_bus[MP_BUS_CNT];
+	uint32_t eax, ebx, ecx, edx;
+	struct mp_fps *fps;
+	struct mp_config *conf;
+	uint8_t *entry;
+	int i;
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	if (edx & CPUID_APIC)
+		lapic_base = read_msr (MSR_APIC_BASE) & ~(uint64_t) 0xfff;
+
+	for (i = 0; i < ISA_IRQ_CNT; i++)
+		isa_irq_pin[i] = i;
+
+	fps = mp_search ();
+	if (fps != NULL && fps->config != 0) {
+		imcr_present = (fps->features[1] & MP_IMCRP) != 0;
+		conf = ptov (fps->config);
+		if (!memcmp (conf->signature, "PCMP", 4)
+				&& checksum_ok (conf, conf->length)) {
+			if (lapic_base == 0)
+				lapic_base = conf->lapic_addr;
+
+			/* Bus entries come before the interrupt entries that
+			   refer to them [MP 4.3]. */
+			entry = (uint8_t *) (conf + 1);
+			for (i = 0; i < conf->entry_cnt; i++) {
+				if (*entry == MP_PROC) {
+					struct mp_proc *proc = (struct mp_proc *) entry;
+					if (proc->flags & MP_PROC_EN)
+						add_cpu (proc->apic_id, proc->flags & MP_PROC_BP);
+					entry += sizeof *proc;
+					continue;
+				}
+
+				if (*entry == MP_BUS) {
+					struct mp_bus *bus = (struct mp_bus *) entry;
+					isa_bus[bus->bus_id] = !memcmp (bus->bus_type, "ISA", 3);
+				} else if (*entry == MP_IOAPIC) {
+					struct mp_ioapic *io = (struct mp_ioapic *) entry;
+					if ((io->flags & MP_IOAPIC_EN) && ioapic_base == 0) {
+						ioapic_base = io->addr;
+						ioapic_id = io->apic_id;
+					}
+				} else if (*entry == MP_IRQ)
+					add_irq ((struct mp_irq *) entry, isa_bus);
+				entry += 8;
+			}
+		}
+	}
+
+	/* No MP tables: just the processor we are running on, whose
+	   APIC ID is in CPUID.1:EBX[31:24]. */
+	if (cpu_cnt == 0)
+		add_cpu (ebx >> 24, true);
+
+	/* Keep the BSP in cpus[0], which thread_init() already gave to
+	   the running thread. */
+	for (i = 1; i < cpu_cnt; i++)
+		if (cpus[i].bsp) {
+			uint8_t apic_id = cpus[0].apic_id;
+			cpus[0].apic_id = cpus[i].apic_id;
+			cpus[0].bsp = true;
+			cpus[i].apic_id = apic_id;
+			cpus[i].bsp = false;
+			break;
+		}
+	cpus[0].online = true;
+	cpu_online_cnt = 1;
+}
+
+/* Returns the CPU we are running on, which the scheduler records
+   in each thread as it switches to it.  Unless interrupts are
+   off, the running thread may move to another CPU at any time,
+   so the answer may be stale by the time the caller uses it.
+
+   Before any AP is started, the BSP is the only possible answer,
+   even early in boot, before thread_init() has given the running
+   thread a CPU. */
+struct cpu *
+cpu_current (void) {
+	struct thread *t;
+
+	if (!aps_started)
+		return &cpus[0];
+	t = pg_round_down (rrsp ());
+	return t->cpu;
+}
+
+/* Makes every CPU flush its TLB before it next takes the kernel
+   lock.  Called after removing kernel mappings that other CPUs
+   may have cached.  Any code that goes on to use the addresses
+   again, on any CPU, first takes the kernel lock, if only to
+   acquire the lock that guards their allocation. */
+void
+cpu_flush_tlbs (void) {
+	enum intr_level old_level = intr_disable ();
+	tlb_gen++;
+	intr_set_level (old_level);
+}
+
+/* Starts the APs, so that they run threads too.  Called by the
+   BSP once it runs threads, with interrupts on.
+
+   Only the round-robin scheduler class keeps a run queue per CPU
+   (see threads/sched-rr.c), so under -mlfqs or -cfs the APs are
+   left halted. */
+void
+cpu_start_aps (void) {
+	extern char ap_trampoline[], ap_trampoline_end[];
+	int i;
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	if (cpu_cnt < 2)
+		return;
+	if (thread_mlfqs || thread_cfs) {
+		printf ("CPU: %d APs left halted, since -mlfqs and -cfs "
+				"run on one CPU\n", cpu_cnt - 1);
+		return;
+	}
+	if (!apic_smp_init ())
+		return;
+	intr_register_ext (LAPIC_RESCHED_VEC, resched_interrupt,
+			"Reschedule IPI");
+
+	memcpy (ptov (AP_BOOT_BASE), ap_trampoline,
+			ap_trampoline_end - ap_trampoline);
+	ap_pml4 = vtop (base_pml4);
+	aps_started = true;
+
+	for (i = 1; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+		struct thread *idle = thread_create_idle (c);
+		uint64_t deadline;
+
+		if (idle == NULL) {
+			printf ("CPU %d: out of memory to start it\n", i);
+			break;
+		}
+		ap_stack = (uint8_t *) idle + PGSIZE;
+		apic_start_ap (c->apic_id, AP_BOOT_BASE);
+
+		deadline = timer_ns () + AP_TIMEOUT_NS;
+		while (!c->online && timer_ns () < deadline)
+			barrier ();
+		if (!c->online) {
+			/* It may still start, on this AP's stack, so start no
+			   more. */
+			printf ("CPU %d (APIC ID %d) did not start\n", i, c->apic_id);
+			break;
+		}
+	}
+}
+
+/* Where each AP starts running C code, with interrupts off, on
+   the stack of its idle thread.  Sets up the AP and makes it run
+   threads.  Does not return. */
+void
+cpu_ap_main (void) {
+	struct cpu *c = cpu_current ();
+
+#ifdef USERPROG
+	gdt_init ();
+#endif
+	intr_init_ap ();
+#ifdef USERPROG
+	syscall_init ();
+#endif
+	apic_init_ap ();
+
+	c->online = true;
+	cpu_online_cnt++;
+	thread_start_ap ();
+}
+
+/* Wakes up an idle CPU, if there is one other than the running
+   CPU, to take a thread that just became ready on the running
+   CPU's run queue, unless the running CPU is idle itself and so
+   will run it shortly anyway.  Interrupts must be off. */
+void
+cpu_kick_idle (void) {
+	struct cpu *self;
+	int i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (cpu_online_cnt < 2)
+		return;
+	self = cpu_current ();
+	if (self->curr == self->idle)
+		return;
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (c != self && c->online && c->curr == c->idle && !c->kicked) {
+			c->kicked = true;
+			apic_send_ipi (c->apic_id, LAPIC_RESCHED_VEC);
+			return;
+		}
+	}
+}
+
+/* Reschedule IPI handler.  Another CPU has a thread for this one
+   to steal. */
+static void
+resched_interrupt (struct intr_frame *f UNUSED) {
+	cpu_current ()->kicked = false;
+	intr_yield_on_return ();
+}
+
+/* Records a CPU with the given local APIC ID. */
+static void
+add_cpu (uint8_t apic_id, bool bsp) {
+	struct cpu *c;
+
+	if (cpu_cnt >= CPU_MAX)
+		return;
+
+	c = &cpus[cpu_cnt];
+	c->id = cpu_cnt++;
+	c->apic_id = apic_id;
+	c->bsp = bsp;
+}
+
+/* Records the I/O APIC pin of an ISA IRQ from MP interrupt entry
+   IRQ.  Entries for other buses and other I/O APICs are ignored;
+   the first I/O APIC handles the ISA IRQs. */
+static void
+add_irq (const struct mp_irq *irq, const bool isa_bus[]) {
+	if (irq->irq_type != MP_IRQ_INT || !isa_bus[irq->src_bus]
+			|| irq->src_irq >= ISA_IRQ_CNT
+			|| (irq->dst_apic != ioapic_id && irq->dst_apic != 0xff))
+		return;
+	isa_irq_pin[irq->src_irq] = irq->dst_pin;
+	isa_irq_flags[irq->src_irq] = irq->flags;
+}
+
+/* Prints per-CPU statistics. */
+void
+cpu_print_stats (void) {
+	int online = 0;
+	int i;
+
+	for (i = 0; i < cpu_cnt; i++)
+		if (cpus[i].online)
+			online++;
+	printf ("CPU: %d found, %d online, local APIC at %#llx, "
+			"I/O APIC at %#llx\n", cpu_cnt, online, lapic_base, ioapic_base);
+	if (online < 2)
+		return;
+	for (i = 0; i < cpu_cnt; i++)
+		if (cpus[i].online)
+			printf ("CPU %d: %lld idle ticks, %lld kernel ticks, "
+					"%lld user ticks, %lld threads stolen\n", i,
+					cpus[i].idle_ticks, cpus[i].kernel_ticks,
+					cpus[i].user_ticks, cpus[i].steals);
+}
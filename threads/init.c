@@ -15,12 +15,18 @@
 #include "devices/vga.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/cpu.h"
 #include "threads/loader.h"
+#include "threads/lockstat.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vmalloc.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -85,7 +91,10 @@ main (void) {
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	slab_init ();
 	paging_init (mem_end);
+	vmalloc_init ();
+	cpu_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -93,6 +102,7 @@ main (void) {
 #endif
 
 	/* Initialize interrupt handlers. */
+	workqueue_init ();
 	intr_init ();
 	timer_init ();
 	kbd_init ();
@@ -103,8 +113,8 @@ main (void) {
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_start ();
 	serial_init_queue ();
-	timer_calibrate ();
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -116,6 +126,9 @@ main (void) {
 	vm_init ();
 #endif
 
+	/* Start the other CPUs. */
+	cpu_start_aps ();
+
 	printf ("Boot complete.\n");
 
 	/* Run actions specified on kernel command line. */
@@ -221,6 +234,22 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp (name, "-lockstat"))
+			lockstat_enabled = true;
+		else if (!strcmp (name, "-irqoff"))
+			irqoff_enabled = true;
+		else if (!strcmp (name, "-donate-depth"))
+			lock_donation_depth = atoi (value);
+		else if (!strcmp (name, "-apic"))
+			intr_use_apic = true;
+		else if (!strcmp (name, "-lapic-timer"))
+			timer_use_lapic = true;
+		else if (!strcmp (name, "-nohz"))
+			timer_nohz = true;
+		else if (!strcmp (name, "-nozero"))
+			palloc_zero_pool = false;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -231,6 +260,9 @@ parse_options (char **argv) {
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs are mutually exclusive");
+
 	return argv;
 }
 
@@ -326,6 +358,14 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use fair-share scheduler.\n"
+			"  -lockstat          Report lock contention at shutdown.\n"
+			"  -irqoff            Report time with interrupts off at shutdown.\n"
+			"  -donate-depth=N    Donate priority along at most N locks.\n"
+			"  -apic              Deliver interrupts through the APICs.\n"
+			"  -lapic-timer       Tick from the local APIC timer (needs -apic).\n"
+			"  -nohz              Stop the timer tick while idle.\n"
+			"  -nozero            Don't pre-zero pages while idle.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -354,6 +394,13 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	cpu_print_stats ();
+	intr_print_stats ();
+	workqueue_print_stats ();
+	palloc_print_stats ();
+	slab_print_stats ();
+	vmalloc_print_stats ();
+	lockstat_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
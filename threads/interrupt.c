@@ -3,6 +3,8 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/apic.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
@@ -87,6 +89,13 @@ static struct desc_ptr idt_desc = {
 
 
 
+/* Returns true if VEC is an external interrupt: an ISA IRQ, from
+   the PICs or the I/O APIC, or one the local APIC raises itself,
+   such as its timer or an IPI.  The local APIC's spurious
+   interrupt vector 0xff is not acknowledged, so it is internal. */
+#define is_external(VEC) \
+	(((VEC) >= 0x20 && (VEC) <= 0x2f) || ((VEC) >= 0xf0 && (VEC) < 0xff))
+
 /* Interrupt handler functions for each interrupt. */
 static intr_handler_func *intr_handlers[INTR_CNT];
 
@@ -99,12 +108,71 @@ static const char *intr_names[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU tracks this for itself, in its
+   in_external_intr and yield_on_return members. */
+
+/* The big kernel lock.  Pintos protects its data by turning
+   interrupts off, which keeps other threads away only on a
+   single CPU.  So that it does the same with several, a CPU in
+   the kernel holds this lock whenever its interrupts are off:
+   turning them off acquires it and turning them back on releases
+   it.  Kernel code with interrupts on, and user code, runs on
+   all CPUs at once.
+
+   The boot CPU starts out with interrupts off, so the lock
+   starts out held. */
+static volatile uint32_t kernel_lock = 1;
+
+static void kernel_lock_acquire (void);
+static void kernel_lock_release (void);
+
+/* Per-vector statistics.  A handler's cycles run from just
+   before it is called until it returns, so they include any
+   interrupts nested within it and, for an internal interrupt
+   whose handler sleeps, the time it spent blocked.  An interrupt
+   is counted as nested if it arrived while the thread it
+   interrupted was itself running an interrupt handler, which
+   each thread tracks in its intr_depth member. */
+static struct intr_stats intr_stats[INTR_CNT];
+
+static void intr_stats_add (uint8_t vec, uint64_t cycles, bool nested,
+		bool yielded);
+
+/* Interrupts-off accounting.  Each interval from interrupts
+   going off to their coming back on is timed with the TSC and
+   charged to the code that turned them off: the caller of
+   intr_disable(), or the handler of an interrupt that arrived
+   while they were on.  An interval is started only when
+   interrupts actually go from on to off and ended only when they
+   go from off to on, so nested intr_disable() calls are not
+   counted separately.  This costs a TSC read on every transition,
+   so it is done only if the "-irqoff" kernel command line option
+   sets irqoff_enabled. */
+bool irqoff_enabled;
+static bool irqoff_open;            /* Timing an interval? */
+static uint64_t irqoff_start;       /* TSC at start of interval. */
+static const void *irqoff_site;     /* Code that started it. */
+static long long irqoff_cnt;        /* # of intervals. */
+static uint64_t irqoff_total;       /* Total cycles with interrupts off. */
+static uint64_t irqoff_max;         /* Longest interval. */
+static const void *irqoff_max_site; /* Code that started the longest. */
+
+static enum intr_level intr_disable_from (const void *site);
+static void irqoff_begin (const void *site);
+static void irqoff_end (void);
+
+/* Deliver interrupts through the APICs, if the machine has them,
+   instead of the 8259A PICs?  Set by the "-apic" kernel command
+   line option. */
+bool intr_use_apic;
+
+/* Are external interrupts delivered through the APICs rather
+   than the PICs?  See threads/apic.c. */
+static bool apic_mode;
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
+static void pic_mask_all (void);
 static void pic_end_of_interrupt (int irq);
 
 /* Interrupt handlers. */
@@ -128,7 +196,8 @@ intr_get_level (void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level (enum intr_level level) {
-	return level == INTR_ON ? intr_enable () : intr_disable ();
+	return level == INTR_ON ? intr_enable ()
+		: intr_disable_from (__builtin_return_address (0));
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
@@ -137,6 +206,12 @@ intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF) {
+		if (irqoff_enabled)
+			irqoff_end ();
+		kernel_lock_release ();
+	}
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -149,6 +224,13 @@ intr_enable (void) {
 /* Disables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_disable (void) {
+	return intr_disable_from (__builtin_return_address (0));
+}
+
+/* Disables interrupts on behalf of the code at SITE and returns
+   the previous interrupt status. */
+static enum intr_level
+intr_disable_from (const void *site) {
 	enum intr_level old_level = intr_get_level ();
 
 	/* Disable interrupts by clearing the interrupt flag.
@@ -156,9 +238,152 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON) {
+		kernel_lock_acquire ();
+		if (irqoff_enabled)
+			irqoff_begin (site);
+	}
 	return old_level;
 }
 
+/* Turns interrupts on and waits for the next one, as an idle CPU
+   does.  Interrupts must be off.
+
+   The `sti' instruction disables interrupts until the completion
+   of the next instruction, so `sti; hlt' is executed atomically.
+   This atomicity is important; otherwise, an interrupt could be
+   handled between re-enabling interrupts and waiting for the
+   next one to occur, wasting as much as one clock tick worth of
+   time.  The kernel lock is released first, since this CPU no
+   longer touches shared data, and the wait is not charged as
+   time with interrupts off.
+
+   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
+   7.11.1 "HLT Instruction". */
+void
+intr_wait (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!intr_context ());
+
+	irqoff_open = false;
+	kernel_lock_release ();
+	asm volatile ("sti; hlt" : : : "memory");
+}
+
+/* Acquires the big kernel lock for the running CPU, whose
+   interrupts must be off, spinning until it is free.  Another CPU
+   may have unmapped kernel pages while this one did not hold the
+   lock, so this also flushes the TLB if cpu_flush_tlbs() has
+   been called since this CPU last did. */
+static void
+kernel_lock_acquire (void) {
+	struct cpu *c;
+	uint32_t held = 1;
+
+	for (;;) {
+		asm volatile ("xchgl %0, %1"
+				: "+r" (held), "+m" (kernel_lock) : : "memory");
+		if (held == 0)
+			break;
+		while (kernel_lock != 0)
+			asm volatile ("pause");
+	}
+
+	c = cpu_current ();
+	if (c->tlb_gen != tlb_gen) {
+		c->tlb_gen = tlb_gen;
+		lcr3 (rcr3 ());
+	}
+}
+
+/* Releases the big kernel lock.  The running CPU's interrupts
+   must be off, and stay off until it no longer touches shared
+   data. */
+static void
+kernel_lock_release (void) {
+	asm volatile ("movl $0, %0" : "=m" (kernel_lock) : : "memory");
+}
+
+/* Starts timing an interval with interrupts off, on behalf of the
+   code at SITE.  Interrupts must be off. */
+static void
+irqoff_begin (const void *site) {
+	irqoff_open = true;
+	irqoff_site = site;
+	irqoff_start = rdtsc ();
+}
+
+/* Ends the interval with interrupts off that is being timed, if
+   any.  Interrupts must be off. */
+static void
+irqoff_end (void) {
+	uint64_t cycles;
+
+	if (!irqoff_open)
+		return;
+	irqoff_open = false;
+
+	cycles = rdtsc () - irqoff_start;
+	irqoff_cnt++;
+	irqoff_total += cycles;
+	if (cycles > irqoff_max) {
+		irqoff_max = cycles;
+		irqoff_max_site = irqoff_site;
+	}
+}
+
+/* Charges a run of the handler for interrupt VEC that took
+   CYCLES cycles. */
+static void
+intr_stats_add (uint8_t vec, uint64_t cycles, bool nested, bool yielded) {
+	struct intr_stats *s = &intr_stats[vec];
+	enum intr_level old_level = intr_disable ();
+
+	s->count++;
+	s->cycles += cycles;
+	if ((int64_t) cycles > s->max_cycles)
+		s->max_cycles = cycles;
+	if (nested)
+		s->nested++;
+	if (yielded)
+		s->yields++;
+	intr_set_level (old_level);
+}
+
+/* Copies the statistics for interrupt VEC into *STATS. */
+void
+intr_get_stats (uint8_t vec, struct intr_stats *stats) {
+	enum intr_level old_level = intr_disable ();
+	*stats = intr_stats[vec];
+	intr_set_level (old_level);
+}
+
+/* Prints interrupt statistics: with -irqoff, how long interrupts
+   were off, and for each vector that was raised, how often and
+   how long its handler ran. */
+void
+intr_print_stats (void) {
+	int vec;
+
+	printf ("Interrupts: %s", apic_mode ? "APIC" : "8259A PIC");
+	if (irqoff_enabled)
+		printf (", off %lld times for %llu cycles, longest %llu cycles "
+				"from %p", irqoff_cnt, irqoff_total, irqoff_max,
+				irqoff_max_site);
+	printf ("\n");
+	for (vec = 0; vec < INTR_CNT; vec++) {
+		struct intr_stats s;
+
+		intr_get_stats (vec, &s);
+		if (s.count == 0)
+			continue;
+		printf ("Interrupt %#04x (%s): %lld times, %lld cycles average, "
+				"%lld max, %lld nested, %lld yields\n",
+				vec, intr_names[vec], s.count, s.cycles / s.count,
+				s.max_cycles, s.nested, s.yields);
+	}
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -201,6 +426,27 @@ intr_init (void) {
 	intr_names[17] = "#AC Alignment Check Exception";
 	intr_names[18] = "#MC Machine-Check Exception";
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
+
+	/* Switch to the APICs if asked to and we can. */
+	if (intr_use_apic && apic_init ()) {
+		pic_mask_all ();
+		apic_mode = true;
+	}
+}
+
+/* Sets up interrupt handling on an AP, which shares the BSP's IDT
+   and handlers, once gdt_init() has given it a TSS.  The AP
+   starts with interrupts off, so this also takes the kernel
+   lock. */
+void
+intr_init_ap (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	kernel_lock_acquire ();
+#ifdef USERPROG
+	ltr (SEL_TSS);
+#endif
+	lidt (&idt_desc);
 }
 
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
@@ -227,7 +473,7 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
-	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+	ASSERT (is_external (vec_no));
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -248,7 +494,7 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name)
 {
-	ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT (!is_external (vec_no));
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
@@ -256,7 +502,12 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
    and false at all other times. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	/* With interrupts on, the running thread may move to another
+	   CPU at any time, but it is not in an interrupt handler on
+	   any of them. */
+	if (intr_get_level () == INTR_ON)
+		return false;
+	return cpu_current ()->in_external_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -266,7 +517,7 @@ intr_context (void) {
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
-	yield_on_return = true;
+	cpu_current ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -308,6 +559,14 @@ pic_init (void) {
 	outb (0xa1, 0x00);
 }
 
+/* Masks all interrupts on both PICs, once the APICs have taken
+   over. */
+static void
+pic_mask_all (void) {
+	outb (0x21, 0xff);
+	outb (0xa1, 0xff);
+}
+
 /* Sends an end-of-interrupt signal to the PIC for the given IRQ.
    If we don't acknowledge the IRQ, it will never be delivered to
    us again, so this is important.  */
@@ -330,24 +589,45 @@ pic_end_of_interrupt (int irq) {
    interrupted thread's registers. */
 void
 intr_handler (struct intr_frame *frame) {
-	bool external;
+	/* The interrupted thread, found from the stack pointer without
+	   thread_current()'s sanity checks, which would turn a fault
+	   taken in the scheduler or on a corrupted stack into a
+	   recursive assertion failure instead of a fault report. */
+	struct thread *curr = pg_round_down (rrsp ());
+	bool external, nested, yielded = false;
 	intr_handler_func *handler;
+	struct cpu *c;
+	uint64_t start;
+
+	/* Entering through an interrupt gate turned interrupts off, if
+	   they were on, so take the kernel lock, and account for the
+	   time with them off. */
+	handler = intr_handlers[frame->vec_no];
+	if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF) {
+		kernel_lock_acquire ();
+		if (irqoff_enabled)
+			irqoff_begin (handler);
+	}
+	c = cpu_current ();
 
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
-	   and they need to be acknowledged on the PIC (see below).
+	   and they need to be acknowledged on the PIC or APIC (see
+	   below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	external = is_external (frame->vec_no);
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
 
-		in_external_intr = true;
-		yield_on_return = false;
+		c->in_external_intr = true;
+		c->yield_on_return = false;
+		timer_irq_enter ();
 	}
 
 	/* Invoke the interrupt's handler. */
-	handler = intr_handlers[frame->vec_no];
+	nested = curr->intr_depth++ > 0;
+	start = rdtsc ();
 	if (handler != NULL)
 		handler (frame);
 	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
@@ -360,17 +640,30 @@ intr_handler (struct intr_frame *frame) {
 		intr_dump_frame (frame);
 		PANIC ("Unexpected interrupt");
 	}
+	curr->intr_depth--;
 
 	/* Complete the processing of an external interrupt. */
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (intr_context ());
 
-		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
-
-		if (yield_on_return)
-			thread_yield ();
+		c->in_external_intr = false;
+		if (apic_mode || frame->vec_no >= 0xf0)
+			apic_eoi ();
+		else
+			pic_end_of_interrupt (frame->vec_no);
+		yielded = c->yield_on_return;
+	}
+	intr_stats_add (frame->vec_no, rdtsc () - start, nested, yielded);
+	if (yielded)
+		thread_yield ();
+
+	/* Returning turns interrupts back on, so give up the kernel
+	   lock.  From here on only the stack is touched. */
+	if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF) {
+		if (irqoff_enabled)
+			irqoff_end ();
+		kernel_lock_release ();
 	}
 }
 
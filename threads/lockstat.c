@@ -0,0 +1,124 @@
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+
+/* Lock contention statistics.
+
+   With "-lockstat" on the kernel command line, lock_acquire() and
+   sema_down() time each acquisition with the TSC and record it
+   here, keyed by the lock or semaphore and the address of the
+   code that acquired it, so that a lock taken from many places
+   shows which of them contend.  lock_release() adds the time the
+   lock was held.
+
+   Statistics live in a fixed-size open-addressing hash table, so
+   that recording never allocates memory: malloc() takes locks of
+   its own.  Acquisitions that find the table full are only
+   counted. */
+
+#define LOCKSTAT_SLOTS 512      /* Size of table, a power of 2. */
+#define LOCKSTAT_TOP 20         /* # of entries to print. */
+
+bool lockstat_enabled;
+
+static struct lockstat table[LOCKSTAT_SLOTS];
+static size_t used_cnt;         /* # of slots in use. */
+static long long dropped_cnt;   /* # of acquisitions not recorded. */
+
+/* Returns a hash of OBJ and SITE. */
+static size_t
+lockstat_hash (const void *obj, const void *site) {
+	uint64_t h = (uint64_t) obj * 0x9e3779b97f4a7c15ull;
+
+	h ^= (uint64_t) site + (h << 6) + (h >> 2);
+	return (h ^ (h >> 29)) & (LOCKSTAT_SLOTS - 1);
+}
+
+/* Records an acquisition of lock or semaphore OBJ, which is a
+   lock if IS_LOCK is true, by the code at SITE, after waiting WAIT
+   cycles, which were spent blocked if CONTENDED is true.  Returns
+   the entry for OBJ and SITE, or a null pointer if the table is
+   full. */
+struct lockstat *
+lockstat_record (const void *obj, const void *site, bool is_lock,
+		bool contended, uint64_t wait) {
+	struct lockstat *s = NULL;
+	enum intr_level old_level;
+	size_t i, n;
+
+	old_level = intr_disable ();
+	for (i = lockstat_hash (obj, site), n = 0; n < LOCKSTAT_SLOTS;
+			i = (i + 1) & (LOCKSTAT_SLOTS - 1), n++) {
+		struct lockstat *e = &table[i];
+		if (e->obj == obj && e->site == site) {
+			s = e;
+			break;
+		}
+		if (e->obj == NULL) {
+			/* Keep a slot free so that lookups end. */
+			if (used_cnt + 1 < LOCKSTAT_SLOTS) {
+				e->obj = obj;
+				e->site = site;
+				e->is_lock = is_lock;
+				used_cnt++;
+				s = e;
+			}
+			break;
+		}
+	}
+
+	if (s != NULL) {
+		s->acquired++;
+		if (contended)
+			s->contended++;
+		s->wait_total += wait;
+		if (wait > s->wait_max)
+			s->wait_max = wait;
+	} else
+		dropped_cnt++;
+	intr_set_level (old_level);
+
+	return s;
+}
+
+/* Prints the LOCKSTAT_TOP entries with the most total wait time,
+   breaking ties by hold time.  Call sites are return addresses,
+   which the "backtrace" utility translates into function names
+   and line numbers. */
+void
+lockstat_print_stats (void) {
+	bool printed[LOCKSTAT_SLOTS] = { false };
+	int i, j;
+
+	if (!lockstat_enabled)
+		return;
+
+	printf ("Lockstat: %zu lock/call site pairs, %lld acquisitions "
+			"dropped\n", used_cnt, dropped_cnt);
+	for (i = 0; i < LOCKSTAT_TOP; i++) {
+		struct lockstat *best = NULL;
+		int best_idx = -1;
+
+		for (j = 0; j < LOCKSTAT_SLOTS; j++) {
+			struct lockstat *e = &table[j];
+			if (e->obj == NULL || printed[j])
+				continue;
+			if (best == NULL || e->wait_total > best->wait_total
+					|| (e->wait_total == best->wait_total
+						&& e->hold_total > best->hold_total)) {
+				best = e;
+				best_idx = j;
+			}
+		}
+		if (best == NULL)
+			break;
+		printed[best_idx] = true;
+
+		printf ("  %s %p from %p: %lld acquired, %lld contended, "
+				"wait %llu total %llu max, hold %llu cycles\n",
+				best->is_lock ? "lock" : "sema", best->obj, best->site,
+				best->acquired, best->contended,
+				best->wait_total, best->wait_max, best->hold_total);
+	}
+}
@@ -1,16 +1,18 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "intrinsic.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
@@ -24,24 +26,95 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed by a binary buddy allocator.  Free memory
+   is kept as blocks of 2**ORDER pages, for ORDER from 0 to
+   PALLOC_MAX_ORDER, each aligned to its size relative to the
+   pool's base, on one free list per order.  Bit ORDER of a pool's
+   free_mask is set if and only if free_lists[ORDER] is nonempty,
+   so the smallest block big enough for a request is found with a
+   single bit scan.  A larger block is split in half until it is
+   the right size, and a freed block is merged with its "buddy",
+   the other half of the block it was split from, for as long as
+   the buddy is free too.  A single page thus takes constant time
+   and N pages O(log N) time, however fragmented the pool is.
+
+   A request for a number of pages that is not a power of two is
+   carved from the next larger block, and the pages past the end
+   of the request go straight back to the free lists, so callers
+   can free any range of pages they were given, as before.
+   Requests for more than 2**PALLOC_MAX_ORDER pages fall back to a
+   linear search for adjacent free blocks of the largest order.
+
+   Free blocks are tracked in an array with an entry per page,
+   not in the free pages themselves, so that the pools can be set
+   up before all of memory is mapped.
+
+   Page tables, thread stacks and anonymous pages all start out
+   zeroed, so palloc_get_page(PAL_ZERO) is common, and clearing
+   4 kB is a large part of its cost.  Each pool therefore keeps a
+   small reserve of pages that the idle thread has already
+   zeroed, which a single-page PAL_ZERO request takes first.  The
+   idle thread refills it in chunks of ZERO_CHUNK pages, going
+   back to the scheduler between chunks, and only for a pool from
+   which zeroed pages have been requested.  The reserve counts as
+   allocated as far as the buddy allocator is concerned, so an
+   allocation that would otherwise fail drains it first. */
+
+/* Per-page state. */
+struct page_info {
+	struct list_elem elem;          /* Free list element. */
+	int8_t order;                   /* Order of the free block that
+	                                   starts here, or -1. */
+};
+
+/* Most pre-zeroed pages to keep in reserve per pool. */
+#define ZERO_RESERVE 32
+
+/* Most pages for the idle thread to zero at a time. */
+#define ZERO_CHUNK 4
 
 /* A memory pool. */
 struct pool {
 	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct page_info *pages;        /* One entry per page. */
+	size_t page_cnt;                /* # of pages in the pool. */
 	uint8_t *base;                  /* Base of pool. */
+
+	struct list free_lists[PALLOC_MAX_ORDER + 1]; /* Free blocks. */
+	uint32_t free_mask;             /* Orders with free blocks. */
+	struct palloc_stats stats;      /* Statistics. */
+
+	/* Pre-zeroed pages.  Interrupts must be off to access these,
+	   not the lock, which the idle thread cannot wait for. */
+	void *zeroed[ZERO_RESERVE];     /* Stack of zeroed pages. */
+	size_t zero_cnt;                /* # of pages in zeroed[]. */
+	bool zero_wanted;               /* PAL_ZERO page requested? */
 };
 
+/* Returned by pool_alloc() on failure. */
+#define PAGE_ERROR SIZE_MAX
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* Keep a reserve of pre-zeroed pages? */
+bool palloc_zero_pool = true;
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+#ifndef NDEBUG
+static bool page_allocated (struct pool *, size_t page_idx);
+#endif
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void *take_zeroed (struct pool *);
+static bool drain_zeroed (struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -219,16 +292,16 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -250,6 +323,9 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+
+	/* Don't count the merges of setting up the free lists. */
+	kernel_pool.stats.merges = user_pool.stats.merges = 0;
 	return ext_mem.end;
 }
 
@@ -263,12 +339,27 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
+	if (page_cnt == 0)
+		return NULL;
+
+	if (page_cnt == 1 && (flags & PAL_ZERO) && palloc_zero_pool) {
+		void *page = take_zeroed (pool);
+		if (page != NULL)
+			return page;
+	}
+
 	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	size_t page_idx = pool_alloc (pool, page_cnt);
+	if (page_idx == PAGE_ERROR && drain_zeroed (pool))
+		page_idx = pool_alloc (pool, page_cnt);
+	if (page_idx != PAGE_ERROR)
+		pool->stats.allocs++;
+	else
+		pool->stats.failures++;
 	lock_release (&pool->lock);
 	void *pages;
 
-	if (page_idx != BITMAP_ERROR)
+	if (page_idx != PAGE_ERROR)
 		pages = pool->base + PGSIZE * page_idx;
 	else
 		pages = NULL;
@@ -315,11 +406,18 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 
 	page_idx = pg_no (pages) - pg_no (pool->base);
 
+	ASSERT (page_idx + page_cnt <= pool->page_cnt);
+
+	lock_acquire (&pool->lock);
 #ifndef NDEBUG
+	/* Catch double frees before they corrupt the free lists. */
+	for (size_t i = 0; i < page_cnt; i++)
+		ASSERT (page_allocated (pool, page_idx + i));
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	pool_free (pool, page_idx, page_cnt);
+	pool->stats.frees++;
+	lock_release (&pool->lock);
 }
 
 /* Frees the page at PAGE. */
@@ -328,23 +426,163 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Stores the statistics of the user pool, if PAL_USER is set in
+   FLAGS, or of the kernel pool, otherwise, into *STATS. */
+void
+palloc_get_stats (enum palloc_flags flags, struct palloc_stats *stats) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+	lock_acquire (&pool->lock);
+	*stats = pool->stats;
+	stats->zeroed_cnt = pool->zero_cnt;
+	lock_release (&pool->lock);
+}
+
+/* Called by the idle thread, with interrupts off, when there is
+   nothing else to run.  Zeroes up to ZERO_CHUNK pages for the
+   reserves of pools that have had PAL_ZERO requests, with
+   interrupts on while it does.  Returns true if it zeroed any
+   page, in which case the caller should look for another thread
+   to run before calling again. */
+bool
+palloc_zero_idle (void) {
+	struct pool *pools[] = { &kernel_pool, &user_pool };
+	size_t zeroed = 0;
+	size_t i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!palloc_zero_pool)
+		return false;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *p = pools[i];
+
+		/* Leave the last free pages to real allocations.  The lock
+		   is taken with interrupts off, so no thread can come to
+		   wait for it, and not at all if another thread holds it. */
+		while (zeroed < ZERO_CHUNK && p->zero_wanted
+				&& p->zero_cnt < ZERO_RESERVE
+				&& p->stats.free_cnt > 2 * ZERO_RESERVE
+				&& lock_try_acquire (&p->lock)) {
+			size_t page_idx = pool_alloc (p, 1);
+			void *page;
+
+			lock_release (&p->lock);
+			if (page_idx == PAGE_ERROR)
+				break;
+
+			page = p->base + PGSIZE * page_idx;
+			intr_enable ();
+			memset (page, 0, PGSIZE);
+			intr_disable ();
+			p->zeroed[p->zero_cnt++] = page;
+			zeroed++;
+		}
+	}
+	return zeroed > 0;
+}
+
+/* Takes a page from P's reserve of zeroed pages and returns it,
+   or returns a null pointer if the reserve is empty. */
+static void *
+take_zeroed (struct pool *p) {
+	enum intr_level old_level;
+	void *page = NULL;
+
+	old_level = intr_disable ();
+	p->zero_wanted = true;
+	if (p->zero_cnt > 0) {
+		page = p->zeroed[--p->zero_cnt];
+		p->stats.zero_hits++;
+	} else
+		p->stats.zero_misses++;
+	intr_set_level (old_level);
+
+	return page;
+}
+
+/* Returns every page in P's reserve of zeroed pages to the buddy
+   allocator.  P's lock must be held.  Returns true if the
+   reserve held any pages. */
+static bool
+drain_zeroed (struct pool *p) {
+	enum intr_level old_level;
+	bool drained = false;
+
+	ASSERT (lock_held_by_current_thread (&p->lock));
+
+	old_level = intr_disable ();
+	while (p->zero_cnt > 0) {
+		void *page = p->zeroed[--p->zero_cnt];
+		pool_free (p, pg_no (page) - pg_no (p->base), 1);
+		drained = true;
+	}
+	intr_set_level (old_level);
+
+	return drained;
+}
+
+/* Prints the statistics and fragmentation of pool P, which is
+   called NAME. */
+static void
+print_pool_stats (const char *name, struct pool *p) {
+	struct palloc_stats s;
+	size_t largest = 0;
+	int order;
+
+	palloc_get_stats (p == &user_pool ? PAL_USER : 0, &s);
+	for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+		if (s.blocks[order] > 0)
+			largest = (size_t) 1 << order;
+
+	printf ("Palloc: %s pool %zu of %zu pages free, largest block %zu, "
+			"%lld allocs, %lld frees, %lld failures, "
+			"%lld splits, %lld merges\n",
+			name, s.free_cnt, s.page_cnt, largest,
+			s.allocs, s.frees, s.failures, s.splits, s.merges);
+	printf ("Palloc: %s pool free blocks by order:", name);
+	for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+		printf (" %zu", s.blocks[order]);
+	printf ("\n");
+	if (palloc_zero_pool)
+		printf ("Palloc: %s pool %zu zeroed pages in reserve, "
+				"%lld hits, %lld misses\n",
+				name, s.zeroed_cnt, s.zero_hits, s.zero_misses);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	print_pool_stats ("kernel", &kernel_pool);
+	print_pool_stats ("user", &user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+  /* We'll put the pool's page array at *BM_BASE, which is past
+     the end of the kernel and so is never handed out.  Every page
+     starts out in use; populate_pools() frees the usable ones. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t info_size = ROUND_UP (pgcnt * sizeof *p->pages, PGSIZE);
+	size_t i;
 
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	lock_init (&p->lock);
+	p->pages = *bm_base;
+	p->page_cnt = pgcnt;
 	p->base = (void *) start;
-
-	// Mark all to unusable.
-	bitmap_set_all(p->used_map, true);
-
-	*bm_base += bm_pages;
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = -1;
+	for (i = 0; i <= PALLOC_MAX_ORDER; i++)
+		list_init (&p->free_lists[i]);
+	p->free_mask = 0;
+	memset (&p->stats, 0, sizeof p->stats);
+	p->stats.page_cnt = pgcnt;
+	p->zero_cnt = 0;
+	p->zero_wanted = false;
+
+	*bm_base += info_size;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -353,6 +591,182 @@ static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
+
+#ifndef NDEBUG
+/* Returns true if page PAGE_IDX of P is allocated: neither in a
+   free block nor in the reserve of zeroed pages.  A free block of
+   2**ORDER pages starts at an index that is a multiple of its
+   size, so the only blocks that can contain PAGE_IDX start at
+   PAGE_IDX rounded down to each order.  P's lock must be held. */
+static bool
+page_allocated (struct pool *p, size_t page_idx) {
+	void *page = p->base + PGSIZE * page_idx;
+	enum intr_level old_level;
+	bool reserved = false;
+	size_t i;
+	int order;
+
+	ASSERT (lock_held_by_current_thread (&p->lock));
+
+	for (order = 0; order <= PALLOC_MAX_ORDER; order++) {
+		size_t head = page_idx & ~(((size_t) 1 << order) - 1);
+		if (p->pages[head].order >= order)
+			return false;
+	}
+
+	old_level = intr_disable ();
+	for (i = 0; i < p->zero_cnt; i++)
+		if (p->zeroed[i] == page)
+			reserved = true;
+	intr_set_level (old_level);
+	return !reserved;
+}
+#endif
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX on P's free
+   lists. */
+static void
+push_block (struct pool *p, size_t page_idx, int order) {
+	struct page_info *pi = &p->pages[page_idx];
+
+	pi->order = order;
+	list_push_front (&p->free_lists[order], &pi->elem);
+	p->free_mask |= 1u << order;
+	p->stats.blocks[order]++;
+	p->stats.free_cnt += (size_t) 1 << order;
+}
+
+/* Takes the free block of 2**ORDER pages at PAGE_IDX off P's free
+   lists. */
+static void
+remove_block (struct pool *p, size_t page_idx, int order) {
+	struct page_info *pi = &p->pages[page_idx];
+
+	ASSERT (pi->order == order);
+
+	list_remove (&pi->elem);
+	if (list_empty (&p->free_lists[order]))
+		p->free_mask &= ~(1u << order);
+	pi->order = -1;
+	p->stats.blocks[order]--;
+	p->stats.free_cnt -= (size_t) 1 << order;
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in P, which must
+   be aligned to its size, merging it with its buddy for as long
+   as the buddy is free. */
+static void
+free_block (struct pool *p, size_t page_idx, int order) {
+	ASSERT (p->pages[page_idx].order == -1);
+	ASSERT ((page_idx & (((size_t) 1 << order) - 1)) == 0);
+
+	while (order < PALLOC_MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy >= p->page_cnt || p->pages[buddy].order != order)
+			break;
+		remove_block (p, buddy, order);
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+		p->stats.merges++;
+	}
+	push_block (p, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in P, as the largest
+   aligned blocks that fit. */
+static void
+pool_free (struct pool *p, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = page_idx != 0 ? bsfq (page_idx) : PALLOC_MAX_ORDER;
+
+		if (order > PALLOC_MAX_ORDER)
+			order = PALLOC_MAX_ORDER;
+		if (order > (int) bsrq (page_cnt))
+			order = bsrq (page_cnt);
+		free_block (p, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Allocates a block of 2**ORDER pages from P, splitting a larger
+   block if there is no free block of that size.  Returns the
+   index of its first page, or PAGE_ERROR if there is no block
+   big enough. */
+static size_t
+alloc_block (struct pool *p, int order) {
+	uint32_t mask = p->free_mask & ~((1u << order) - 1);
+	struct page_info *pi;
+	size_t page_idx;
+	int o;
+
+	if (mask == 0)
+		return PAGE_ERROR;
+
+	o = bsfq (mask);
+	pi = list_entry (list_front (&p->free_lists[o]), struct page_info, elem);
+	page_idx = pi - p->pages;
+	remove_block (p, page_idx, o);
+	while (o > order) {
+		o--;
+		push_block (p, page_idx + ((size_t) 1 << o), o);
+		p->stats.splits++;
+	}
+	return page_idx;
+}
+
+/* Allocates more than 2**PALLOC_MAX_ORDER pages from P by looking
+   for enough adjacent free blocks of the largest order.  This
+   takes time linear in the size of the pool, but such requests
+   are rare. */
+static size_t
+alloc_huge (struct pool *p, size_t page_cnt) {
+	const size_t block_pages = (size_t) 1 << PALLOC_MAX_ORDER;
+	size_t block_cnt = DIV_ROUND_UP (page_cnt, block_pages);
+	size_t run_start = 0, run_cnt = 0;
+	size_t i;
+
+	for (i = 0; i + block_pages <= p->page_cnt; i += block_pages) {
+		if (p->pages[i].order != PALLOC_MAX_ORDER) {
+			run_cnt = 0;
+			continue;
+		}
+		if (run_cnt++ == 0)
+			run_start = i;
+		if (run_cnt == block_cnt) {
+			for (i = 0; i < block_cnt; i++)
+				remove_block (p, run_start + i * block_pages,
+						PALLOC_MAX_ORDER);
+			return run_start;
+		}
+	}
+	return PAGE_ERROR;
+}
+
+/* Allocates PAGE_CNT contiguous pages from P and returns the
+   index of the first one, or PAGE_ERROR if P has no free range
+   that large.  Pages of the block beyond PAGE_CNT are freed
+   again. */
+static size_t
+pool_alloc (struct pool *p, size_t page_cnt) {
+	size_t page_idx, block_pages;
+
+	ASSERT (page_cnt > 0);
+
+	if (page_cnt > ((size_t) 1 << PALLOC_MAX_ORDER)) {
+		page_idx = alloc_huge (p, page_cnt);
+		block_pages = ROUND_UP (page_cnt, (size_t) 1 << PALLOC_MAX_ORDER);
+	} else {
+		int order = page_cnt > 1 ? bsrq (page_cnt - 1) + 1 : 0;
+
+		page_idx = alloc_block (p, order);
+		block_pages = (size_t) 1 << order;
+	}
+	if (page_idx != PAGE_ERROR && block_pages > page_cnt)
+		pool_free (p, page_idx + page_cnt, block_pages - page_cnt);
+	return page_idx;
+}
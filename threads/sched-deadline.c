@@ -0,0 +1,310 @@
+#include "threads/sched.h"
+#include <debug.h>
+#include <heap.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+
+/* Earliest-deadline-first scheduler class.
+
+   A thread joins this class with thread_set_deadline(), declaring
+   that every PERIOD ticks it needs RUNTIME ticks of CPU within
+   DEADLINE ticks of the start of the period.  Deadline threads
+   always run ahead of threads of the base class, and among
+   themselves the one whose current deadline is earliest runs
+   first.
+
+   Admission control keeps the sum of RUNTIME / PERIOD over all
+   deadline threads within DL_BW_LIMIT, which leaves some CPU to
+   the base class and, since DEADLINE <= PERIOD, keeps EDF able to
+   meet every deadline as long as threads stay within their
+   budgets.
+
+   Each thread has a kernel timer that fires at the start of each
+   period to replenish its budget and set its next deadline.  The
+   timer tick charges the running thread's budget, and a thread
+   that exhausts it is throttled, that is, kept off the run queue
+   until its next period, so an overrunning thread cannot steal
+   time from the others.
+
+   A thread calls thread_deadline_yield() when it has finished
+   the work of a period.  A deadline miss is counted when a thread
+   finishes after its deadline, or has not finished by the start
+   of its next period. */
+
+/* Bandwidth is RUNTIME / PERIOD as a fraction of DL_BW_ONE. */
+#define DL_BW_SHIFT 20
+#define DL_BW_ONE (1 << DL_BW_SHIFT)
+
+/* Most bandwidth that deadline threads may reserve in total. */
+#define DL_BW_LIMIT (DL_BW_ONE / 100 * 95)
+
+static struct heap dl_queue;    /* Ready threads, by deadline. */
+static int64_t dl_total_bw;     /* Reserved bandwidth. */
+
+/* Statistics. */
+static long long dl_admitted;   /* # of threads admitted. */
+static long long dl_rejected;   /* # of threads refused admission. */
+static long long dl_misses;     /* # of deadlines missed. */
+static long long dl_throttles;  /* # of times a thread ran out of budget. */
+
+static bool dl_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static void dl_replenish (void *t_);
+static void dl_check_preempt (void);
+
+static void
+dl_init (void) {
+	heap_init (&dl_queue, dl_less, NULL);
+	dl_total_bw = 0;
+}
+
+/* Orders threads by absolute deadline, earliest first, breaking
+   ties in favor of the older thread. */
+static bool
+dl_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, rq_elem);
+	const struct thread *b = heap_entry (b_, struct thread, rq_elem);
+
+	if (a->dl.abs_deadline != b->dl.abs_deadline)
+		return a->dl.abs_deadline < b->dl.abs_deadline;
+	return a->tid < b->tid;
+}
+
+/* Returns the bandwidth of RUNTIME ticks every PERIOD ticks. */
+static int64_t
+dl_bw (int64_t runtime, int64_t period) {
+	return (runtime << DL_BW_SHIFT) / period;
+}
+
+/* Adds T to the run queue, unless it has used up its budget for
+   this period, in which case it is throttled until dl_replenish()
+   puts it back. */
+static void
+dl_enqueue (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->dl.budget <= 0) {
+		t->dl.throttled = true;
+		dl_throttles++;
+		return;
+	}
+	heap_push (&dl_queue, &t->rq_elem);
+}
+
+/* Removes ready thread T from the run queue. */
+static void
+dl_dequeue (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	if (t->dl.throttled)
+		t->dl.throttled = false;
+	else
+		heap_remove (&dl_queue, &t->rq_elem);
+}
+
+/* Removes and returns the ready thread with the earliest
+   deadline, or a null pointer if there is none. */
+static struct thread *
+dl_pick_next (void) {
+	if (heap_empty (&dl_queue))
+		return NULL;
+	return heap_entry (heap_pop (&dl_queue), struct thread, rq_elem);
+}
+
+/* Charges the tick to CURR's budget.  CURR is preempted, and then
+   throttled by dl_enqueue(), once the budget runs out. */
+static bool
+dl_tick (struct thread *curr, unsigned ticks_run UNUSED) {
+	return --curr->dl.budget <= 0;
+}
+
+/* Priorities play no part in deadline scheduling. */
+static bool
+dl_prio_changed (struct thread *t UNUSED, int old_priority UNUSED) {
+	return false;
+}
+
+/* T preempts CURR if its deadline is earlier. */
+static bool
+dl_preempts (const struct thread *t, const struct thread *curr) {
+	return t->dl.abs_deadline < curr->dl.abs_deadline;
+}
+
+/* Releases the bandwidth of exiting thread CURR. */
+static void
+dl_exit (struct thread *curr) {
+	ktimer_cancel (&curr->dl.timer);
+	dl_total_bw -= dl_bw (curr->dl.runtime, curr->dl.period);
+}
+
+/* Prints deadline scheduling statistics. */
+static void
+dl_print_stats (void) {
+	printf ("Deadline: %lld admitted, %lld rejected, %lld misses, "
+			"%lld throttles\n",
+			dl_admitted, dl_rejected, dl_misses, dl_throttles);
+}
+
+/* Starts the next period of thread T_: replenishes its budget,
+   moves its deadline, and makes it runnable again if it was
+   throttled or waiting for this period.  Runs in the timer
+   interrupt. */
+static void
+dl_replenish (void *t_) {
+	struct thread *t = t_;
+	bool queued = t->status == THREAD_READY && !t->dl.throttled;
+
+	if (queued)
+		heap_remove (&dl_queue, &t->rq_elem);
+
+	/* A job still running at the start of the next period has
+	   missed its deadline, unless that was already counted. */
+	if (!t->dl.job_done && !t->dl.job_missed) {
+		t->dl.misses++;
+		dl_misses++;
+	}
+
+	t->dl.release += t->dl.period;
+	t->dl.abs_deadline = t->dl.release + t->dl.deadline;
+	t->dl.budget = t->dl.runtime;
+	t->dl.job_done = t->dl.job_missed = false;
+	ktimer_add (&t->dl.timer, t->dl.release + t->dl.period);
+
+	if (queued)
+		heap_push (&dl_queue, &t->rq_elem);
+	else if (t->dl.throttled) {
+		t->dl.throttled = false;
+		heap_push (&dl_queue, &t->rq_elem);
+	} else if (t->dl.waiting) {
+		t->dl.waiting = false;
+		thread_unblock (t);
+	}
+
+	dl_check_preempt ();
+}
+
+/* Requests a reschedule on return from the interrupt if the
+   earliest-deadline ready thread should run instead of the
+   running thread. */
+static void
+dl_check_preempt (void) {
+	struct thread *t;
+
+	if (heap_empty (&dl_queue))
+		return;
+	t = heap_entry (heap_top (&dl_queue), struct thread, rq_elem);
+	if (thread_preempts (t))
+		intr_yield_on_return ();
+}
+
+/* Moves the running thread into the deadline class, so that it
+   gets RUNTIME ticks of CPU within DEADLINE ticks of the start of
+   each period of PERIOD ticks, starting now.  Requires
+   0 < RUNTIME <= DEADLINE <= PERIOD.
+
+   Returns true if successful.  Returns false, leaving the thread
+   as it was, if admitting it would reserve more than DL_BW_LIMIT
+   of the CPU for deadline threads or the thread is already a
+   deadline thread. */
+bool
+thread_set_deadline (int64_t runtime, int64_t deadline, int64_t period) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	int64_t bw;
+
+	ASSERT (0 < runtime && runtime <= deadline && deadline <= period);
+
+	old_level = intr_disable ();
+	bw = dl_bw (runtime, period);
+	if (curr->sched_class == &dl_sched_class
+			|| dl_total_bw + bw > DL_BW_LIMIT) {
+		dl_rejected++;
+		intr_set_level (old_level);
+		return false;
+	}
+	dl_total_bw += bw;
+	dl_admitted++;
+
+	curr->dl.runtime = runtime;
+	curr->dl.deadline = deadline;
+	curr->dl.period = period;
+	curr->dl.release = timer_ticks ();
+	curr->dl.abs_deadline = curr->dl.release + deadline;
+	curr->dl.budget = runtime;
+	curr->dl.throttled = curr->dl.waiting = false;
+	curr->dl.job_done = curr->dl.job_missed = false;
+	curr->dl.misses = 0;
+	ktimer_init (&curr->dl.timer, dl_replenish, curr);
+	ktimer_add (&curr->dl.timer, curr->dl.release + period);
+	curr->sched_class = &dl_sched_class;
+
+	/* Let a deadline thread with an earlier deadline go first. */
+	if (!heap_empty (&dl_queue)
+			&& thread_preempts (heap_entry (heap_top (&dl_queue),
+					struct thread, rq_elem)))
+		thread_yield ();
+	intr_set_level (old_level);
+
+	return true;
+}
+
+/* Returns the running thread, which must be a deadline thread,
+   to the base scheduler class and releases its bandwidth. */
+void
+thread_clear_deadline (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	ASSERT (curr->sched_class == &dl_sched_class);
+	dl_exit (curr);
+	curr->sched_class = base_class;
+	if (base_class->switched_to != NULL)
+		base_class->switched_to (curr);
+	thread_yield ();
+	intr_set_level (old_level);
+}
+
+/* Marks the work of the running deadline thread's current period
+   as done, and blocks until its next period starts. */
+void
+thread_deadline_yield (void) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	ASSERT (curr->sched_class == &dl_sched_class);
+	if (timer_ticks () > curr->dl.abs_deadline && !curr->dl.job_missed) {
+		curr->dl.job_missed = true;
+		curr->dl.misses++;
+		dl_misses++;
+	}
+	curr->dl.job_done = true;
+	curr->dl.waiting = true;
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Returns the number of deadlines that the running thread has
+   missed since it called thread_set_deadline(). */
+int
+thread_get_deadline_misses (void) {
+	return thread_current ()->dl.misses;
+}
+
+const struct sched_class dl_sched_class = {
+	.name = "deadline",
+	.init = dl_init,
+	.enqueue = dl_enqueue,
+	.dequeue = dl_dequeue,
+	.pick_next = dl_pick_next,
+	.yield = dl_enqueue,
+	.tick = dl_tick,
+	.prio_changed = dl_prio_changed,
+	.preempts = dl_preempts,
+	.exit = dl_exit,
+	.print_stats = dl_print_stats,
+};
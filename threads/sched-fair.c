@@ -0,0 +1,234 @@
+#include "threads/sched.h"
+#include <debug.h>
+#include <heap.h>
+#include "threads/interrupt.h"
+
+/* Fair-share scheduler class.
+
+   The fair-share scheduler gives each thread a share of the CPU
+   in proportion to a weight derived from its nice value.  Each
+   thread accumulates "virtual runtime": the CPU time it has used,
+   scaled down by its weight, so that a heavier thread's clock
+   runs slower.  The ready thread with the least virtual runtime
+   runs next, and it runs for a slice of CFS_LATENCY divided among
+   the runnable threads by weight.  Ready threads are kept in a
+   heap ordered by virtual runtime. */
+
+#define CFS_LATENCY 8           /* Target latency, in timer ticks. */
+#define CFS_MIN_GRAN 1          /* Minimum slice, in timer ticks. */
+#define NICE_0_WEIGHT 1024      /* Weight of a thread with nice 0. */
+
+/* Virtual runtime is measured in units of 1/VRUNTIME_ONE of a
+   timer tick used by a nice-0 thread. */
+#define VRUNTIME_ONE 1024
+
+/* A waking thread preempts the running thread only if it is
+   behind it by more than this much virtual runtime. */
+#define CFS_WAKEUP_GRAN VRUNTIME_ONE
+
+/* A thread that wakes up after sleeping is placed at most this
+   far behind the least virtual runtime in the run queue, so that
+   it runs soon but cannot bank credit for the time it slept. */
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY * VRUNTIME_ONE / 2)
+
+/* Weight for each nice value from NICE_MIN to NICE_MAX.  Each
+   step of nice changes the weight by about 25%, so that a thread
+   that is one nice level lower gets about 10% more CPU than its
+   neighbor.  These are the weights used by Linux, extended by one
+   entry for nice 20. */
+static const unsigned cfs_weights[NICE_MAX - NICE_MIN + 1] = {
+	88761, 71755, 56483, 46273, 36291,      /* -20 ... -16 */
+	29154, 23254, 18705, 14949, 11916,      /* -15 ... -11 */
+	9548, 7620, 6100, 4904, 3906,           /* -10 ...  -6 */
+	3121, 2501, 1991, 1586, 1277,           /*  -5 ...  -1 */
+	1024, 820, 655, 526, 423,               /*   0 ...   4 */
+	335, 272, 215, 172, 137,                /*   5 ...   9 */
+	110, 87, 70, 56, 45,                    /*  10 ...  14 */
+	36, 29, 23, 18, 15,                     /*  15 ...  19 */
+	12,                                     /*  20 */
+};
+
+static struct heap cfs_queue;           /* Ready threads, by vruntime. */
+static uint64_t cfs_min_vruntime;       /* Never decreases. */
+static unsigned long cfs_load;          /* Total weight in cfs_queue. */
+static size_t cfs_nr_ready;             /* # of threads in cfs_queue. */
+
+static bool cfs_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static void cfs_update_min_vruntime (void);
+
+static void
+cfs_init (void) {
+	heap_init (&cfs_queue, cfs_less, NULL);
+	cfs_min_vruntime = 0;
+	cfs_load = 0;
+	cfs_nr_ready = 0;
+}
+
+/* Returns the fair-share weight of T. */
+static unsigned
+cfs_weight (const struct thread *t) {
+	ASSERT (NICE_MIN <= t->nice && t->nice <= NICE_MAX);
+
+	return cfs_weights[t->nice - NICE_MIN];
+}
+
+/* Orders threads by virtual runtime, least first, breaking ties
+   in favor of the older thread. */
+static bool
+cfs_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, rq_elem);
+	const struct thread *b = heap_entry (b_, struct thread, rq_elem);
+
+	if (a->vruntime != b->vruntime)
+		return a->vruntime < b->vruntime;
+	return a->tid < b->tid;
+}
+
+/* Adds T to the run queue as is. */
+static void
+cfs_yield (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	heap_push (&cfs_queue, &t->rq_elem);
+	cfs_load += cfs_weight (t);
+	cfs_nr_ready++;
+}
+
+/* Adds T, which is waking up, to the run queue, first moving its
+   virtual runtime up to no more than CFS_SLEEPER_CREDIT behind
+   cfs_min_vruntime.  Without this a thread that slept for a long
+   time would hog the CPU until it caught up with everyone
+   else. */
+static void
+cfs_enqueue (struct thread *t) {
+	uint64_t floor = cfs_min_vruntime > CFS_SLEEPER_CREDIT
+		? cfs_min_vruntime - CFS_SLEEPER_CREDIT : 0;
+
+	if (t->vruntime < floor)
+		t->vruntime = floor;
+	cfs_yield (t);
+}
+
+/* Removes ready thread T from the run queue. */
+static void
+cfs_dequeue (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	heap_remove (&cfs_queue, &t->rq_elem);
+	cfs_load -= cfs_weight (t);
+	cfs_nr_ready--;
+}
+
+/* Removes and returns the ready thread with the least virtual
+   runtime, in O(log N) amortized time, or a null pointer if the
+   run queue is empty. */
+static struct thread *
+cfs_pick_next (void) {
+	struct thread *next;
+
+	if (heap_empty (&cfs_queue))
+		return NULL;
+
+	next = heap_entry (heap_pop (&cfs_queue), struct thread, rq_elem);
+	cfs_load -= cfs_weight (next);
+	cfs_nr_ready--;
+	return next;
+}
+
+/* Returns the number of ticks that running thread T may run
+   before yielding: its share, by weight, of a scheduling period
+   of CFS_LATENCY ticks.  The period stretches when there are too
+   many runnable threads to give each of them CFS_MIN_GRAN. */
+static unsigned
+cfs_timeslice (const struct thread *t) {
+	unsigned long nr_running = cfs_nr_ready + 1;
+	unsigned long period = CFS_LATENCY;
+	unsigned long weight, slice;
+
+	if (t == idle_thread)
+		return CFS_MIN_GRAN;
+
+	if (nr_running > CFS_LATENCY / CFS_MIN_GRAN)
+		period = nr_running * CFS_MIN_GRAN;
+	weight = cfs_weight (t);
+	slice = period * weight / (cfs_load + weight);
+	return slice > CFS_MIN_GRAN ? slice : CFS_MIN_GRAN;
+}
+
+/* Charges the tick to CURR's virtual runtime, and preempts it
+   once it has used up its slice. */
+static bool
+cfs_tick (struct thread *curr, unsigned ticks_run) {
+	if (curr != idle_thread)
+		curr->vruntime += (uint64_t) VRUNTIME_ONE * NICE_0_WEIGHT
+			/ cfs_weight (curr);
+	cfs_update_min_vruntime ();
+
+	return ticks_run >= cfs_timeslice (curr);
+}
+
+/* Advances cfs_min_vruntime to the least virtual runtime among
+   the running thread and the ready threads.  It never moves
+   backward. */
+static void
+cfs_update_min_vruntime (void) {
+	struct thread *curr = thread_current ();
+	uint64_t min = UINT64_MAX;
+
+	if (curr != idle_thread)
+		min = curr->vruntime;
+	if (!heap_empty (&cfs_queue)) {
+		struct thread *t = heap_entry (heap_top (&cfs_queue),
+				struct thread, rq_elem);
+		if (t->vruntime < min)
+			min = t->vruntime;
+	}
+	if (min != UINT64_MAX && min > cfs_min_vruntime)
+		cfs_min_vruntime = min;
+}
+
+/* Priorities play no part in fair-share scheduling. */
+static bool
+cfs_prio_changed (struct thread *t UNUSED, int old_priority UNUSED) {
+	return false;
+}
+
+/* T preempts CURR if it is sufficiently far behind in virtual
+   runtime. */
+static bool
+cfs_preempts (const struct thread *t, const struct thread *curr) {
+	return t->vruntime + CFS_WAKEUP_GRAN < curr->vruntime;
+}
+
+/* The new thread inherits its creator's nice and starts level
+   with the least-served ready thread. */
+static void
+cfs_fork (struct thread *t, const struct thread *parent) {
+	t->nice = parent->nice;
+	t->vruntime = cfs_min_vruntime;
+}
+
+/* A thread returning from another class starts no further behind
+   than the least-served ready thread. */
+static void
+cfs_switched_to (struct thread *curr) {
+	if (curr->vruntime < cfs_min_vruntime)
+		curr->vruntime = cfs_min_vruntime;
+}
+
+const struct sched_class fair_sched_class = {
+	.name = "fair",
+	.init = cfs_init,
+	.enqueue = cfs_enqueue,
+	.dequeue = cfs_dequeue,
+	.pick_next = cfs_pick_next,
+	.yield = cfs_yield,
+	.tick = cfs_tick,
+	.prio_changed = cfs_prio_changed,
+	.preempts = cfs_preempts,
+	.fork = cfs_fork,
+	.switched_to = cfs_switched_to,
+};
@@ -0,0 +1,177 @@
+#include "threads/sched.h"
+#include <debug.h>
+#include "threads/fixed-point.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+
+/* Multi-level feedback queue scheduler class, after 4.4BSD.
+
+   Priorities are computed from each thread's recent CPU usage
+   and nice value instead of being set by the thread.  Threads
+   are kept in the round-robin class's priority run queue, so
+   only the per-tick bookkeeping differs. */
+
+/* System load average: the number of threads ready to run,
+   averaged exponentially over the last minute. */
+static fixed_t load_avg;
+
+static void mlfqs_update_all (void);
+static void mlfqs_update (struct thread *, void *coef);
+
+static void
+mlfqs_init (void) {
+	rr_sched_class.init ();
+	load_avg = 0;
+}
+
+/* Returns the MLFQS priority of T,
+   PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to the valid
+   priority range. */
+static int
+mlfqs_priority (const struct thread *t) {
+	int priority = PRI_MAX - fp_to_int (t->recent_cpu / 4) - t->nice * 2;
+
+	if (priority < PRI_MIN)
+		return PRI_MIN;
+	if (priority > PRI_MAX)
+		return PRI_MAX;
+	return priority;
+}
+
+/* MLFQS bookkeeping for every timer tick: charges the tick to
+   the running thread's recent_cpu and, once per second, updates
+   every thread.
+
+   Only the running thread's recent_cpu changes from tick to
+   tick, so only its priority is recomputed every fourth tick, by
+   mlfqs_tick().  Every other thread's priority changes just once
+   per second, when recent_cpu decays, and mlfqs_update_all()
+   handles that in a single pass.  Thus the cost of a tick does
+   not depend on the number of threads, except for one tick per
+   second.  This runs whatever class the running thread is in, so
+   that the load average keeps up while deadline threads run. */
+static void
+mlfqs_clock (struct thread *curr) {
+	if (curr != idle_thread && curr->sched_class == &mlfqs_sched_class)
+		curr->recent_cpu = fp_add_int (curr->recent_cpu, 1);
+
+	if (timer_ticks () % TIMER_FREQ == 0)
+		mlfqs_update_all ();
+}
+
+/* Recomputes running thread CURR's priority every fourth tick,
+   and preempts it if a ready thread then outranks it or its time
+   slice is up. */
+static bool
+mlfqs_tick (struct thread *curr, unsigned ticks_run) {
+	if (timer_ticks () % 4 == 0) {
+		if (curr != idle_thread) {
+			curr->priority = mlfqs_priority (curr);
+			synch_priority_changed (curr);
+		}
+		if (rr_max_priority () > curr->priority)
+			return true;
+	}
+	return ticks_run >= TIME_SLICE;
+}
+
+/* Once-per-second MLFQS update: recomputes the load average, then
+   decays every thread's recent_cpu and recomputes its priority,
+   moving ready threads to their new run queue. */
+static void
+mlfqs_update_all (void) {
+	int ready_threads = rr_nr_ready ()
+		+ (thread_current () != idle_thread ? 1 : 0);
+	fixed_t coef;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	load_avg = (59 * load_avg + fp_from_int (ready_threads)) / 60;
+	coef = fp_div (2 * load_avg, 2 * load_avg + FP_ONE);
+	thread_foreach (mlfqs_update, &coef);
+}
+
+/* Decays T's recent_cpu by *COEF_ and recomputes its priority.
+   Helper for mlfqs_update_all(). */
+static void
+mlfqs_update (struct thread *t, void *coef_) {
+	fixed_t coef = *(fixed_t *) coef_;
+	int priority;
+
+	if (t == idle_thread || t->sched_class != &mlfqs_sched_class)
+		return;
+
+	t->recent_cpu = fp_mul (coef, t->recent_cpu) + fp_from_int (t->nice);
+	priority = mlfqs_priority (t);
+	if (priority == t->priority)
+		return;
+
+	if (t->status == THREAD_READY) {
+		rr_dequeue (t);
+		t->priority = priority;
+		rr_enqueue (t);
+	} else
+		t->priority = priority;
+	synch_priority_changed (t);
+}
+
+/* Priorities are not set by threads under the MLFQS, so this is
+   only reached through mlfqs_nice_changed(). */
+static bool
+mlfqs_prio_changed (struct thread *t UNUSED, int old_priority UNUSED) {
+	return rr_max_priority () > thread_current ()->priority;
+}
+
+/* The new thread inherits its creator's nice and recent_cpu. */
+static void
+mlfqs_fork (struct thread *t, const struct thread *parent) {
+	t->nice = parent->nice;
+	t->recent_cpu = parent->recent_cpu;
+	t->priority = mlfqs_priority (t);
+}
+
+/* Recomputes the running thread's priority for its new nice
+   value. */
+static bool
+mlfqs_nice_changed (struct thread *curr) {
+	int old_priority = curr->priority;
+
+	curr->priority = mlfqs_priority (curr);
+	return mlfqs_prio_changed (curr, old_priority);
+}
+
+/* Returns 100 times the system load average. */
+int
+thread_get_load_avg (void) {
+	enum intr_level old_level = intr_disable ();
+	int load = fp_round (load_avg * 100);
+	intr_set_level (old_level);
+
+	return load;
+}
+
+/* Returns 100 times the current thread's recent_cpu value. */
+int
+thread_get_recent_cpu (void) {
+	enum intr_level old_level = intr_disable ();
+	int recent = fp_round (thread_current ()->recent_cpu * 100);
+	intr_set_level (old_level);
+
+	return recent;
+}
+
+const struct sched_class mlfqs_sched_class = {
+	.name = "mlfqs",
+	.init = mlfqs_init,
+	.enqueue = rr_enqueue,
+	.dequeue = rr_dequeue,
+	.pick_next = rr_pick_next,
+	.yield = rr_yield,
+	.tick = mlfqs_tick,
+	.prio_changed = mlfqs_prio_changed,
+	.preempts = rr_preempts,
+	.fork = mlfqs_fork,
+	.nice_changed = mlfqs_nice_changed,
+	.clock = mlfqs_clock,
+};
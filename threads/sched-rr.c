@@ -0,0 +1,190 @@
+#include "threads/sched.h"
+#include <debug.h>
+#include <list.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "intrinsic.h"
+
+/* Round-robin scheduler class.
+
+   Each CPU has its own run queue, with one FIFO list per
+   priority level.  Bit P of a queue's `mask' is set if and only
+   if its lists[P] is nonempty, so the highest-priority ready
+   thread is found with a single bit scan regardless of how many
+   threads are ready.  Threads of equal priority take turns,
+   TIME_SLICE ticks at a time.
+
+   A thread that becomes ready goes on the run queue of the CPU
+   that readied it, which it records in its `cpu' member.  A CPU
+   whose own run queue is empty steals the highest-priority
+   thread from the longest of the others before going idle, so
+   that threads created on one CPU spread to the rest. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* A run queue. */
+struct rr_rq {
+	struct list lists[PRI_CNT];
+	uint64_t mask;
+	size_t cnt;                 /* # of threads in the run queue. */
+};
+
+static struct rr_rq rqs[CPU_MAX];
+
+static void
+rr_init (void) {
+	int i, j;
+
+	for (i = 0; i < CPU_MAX; i++) {
+		for (j = 0; j < PRI_CNT; j++)
+			list_init (&rqs[i].lists[j]);
+		rqs[i].mask = 0;
+		rqs[i].cnt = 0;
+	}
+}
+
+/* Adds T to the back of RQ's list for its priority. */
+static void
+rq_push (struct rr_rq *rq, struct thread *t) {
+	list_push_back (&rq->lists[t->priority - PRI_MIN], &t->elem);
+	rq->mask |= 1ull << (t->priority - PRI_MIN);
+	rq->cnt++;
+}
+
+/* Removes and returns the front thread of RQ's highest nonempty
+   priority level, which must exist.  Takes constant time. */
+static struct thread *
+rq_pop (struct rr_rq *rq) {
+	struct thread *t;
+	struct list *queue;
+	int idx;
+
+	ASSERT (rq->mask != 0);
+
+	idx = bsrq (rq->mask);
+	queue = &rq->lists[idx];
+	t = list_entry (list_pop_front (queue), struct thread, elem);
+	if (list_empty (queue))
+		rq->mask &= ~(1ull << idx);
+	rq->cnt--;
+	return t;
+}
+
+/* Adds T to the back of the running CPU's run queue for its
+   priority. */
+void
+rr_enqueue (struct thread *t) {
+	struct cpu *c = cpu_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	t->cpu = c;
+	rq_push (&rqs[c->id], t);
+}
+
+/* Removes ready thread T from its run queue. */
+void
+rr_dequeue (struct thread *t) {
+	struct rr_rq *rq = &rqs[t->cpu->id];
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	list_remove (&t->elem);
+	if (list_empty (&rq->lists[t->priority - PRI_MIN]))
+		rq->mask &= ~(1ull << (t->priority - PRI_MIN));
+	rq->cnt--;
+}
+
+/* Removes and returns the next thread for the running CPU: the
+   front thread of the highest nonempty priority level of its run
+   queue, or if that is empty, of the longest other run queue.
+   Returns a null pointer if every run queue is empty. */
+struct thread *
+rr_pick_next (void) {
+	struct cpu *c = cpu_current ();
+	struct rr_rq *victim = NULL;
+	int i;
+
+	if (rqs[c->id].mask != 0)
+		return rq_pop (&rqs[c->id]);
+
+	for (i = 0; i < cpu_cnt; i++)
+		if (rqs[i].cnt > 0 && (victim == NULL || rqs[i].cnt > victim->cnt))
+			victim = &rqs[i];
+	if (victim == NULL)
+		return NULL;
+	c->steals++;
+	return rq_pop (victim);
+}
+
+/* A yielding thread goes to the back of its priority level. */
+void
+rr_yield (struct thread *curr) {
+	rr_enqueue (curr);
+}
+
+/* Returns true if T has a higher priority than CURR. */
+bool
+rr_preempts (const struct thread *t, const struct thread *curr) {
+	return t->priority > curr->priority;
+}
+
+/* Returns the priority of the highest-priority thread in the
+   running CPU's run queue, or PRI_MIN - 1 if it is empty. */
+int
+rr_max_priority (void) {
+	struct rr_rq *rq = &rqs[cpu_current ()->id];
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rq->mask == 0)
+		return PRI_MIN - 1;
+	return PRI_MIN + (int) bsrq (rq->mask);
+}
+
+/* Returns the number of threads in all the run queues. */
+size_t
+rr_nr_ready (void) {
+	size_t cnt = 0;
+	int i;
+
+	for (i = 0; i < CPU_MAX; i++)
+		cnt += rqs[i].cnt;
+	return cnt;
+}
+
+static bool
+rr_tick (struct thread *curr UNUSED, unsigned ticks_run) {
+	return ticks_run >= TIME_SLICE;
+}
+
+/* Moves T to the list for its new priority, in the same run
+   queue, if it is ready.  The running thread should yield if a
+   thread ready on its CPU now outranks it. */
+static bool
+rr_prio_changed (struct thread *t, int old_priority) {
+	if (t->status == THREAD_READY) {
+		int new_priority = t->priority;
+
+		t->priority = old_priority;
+		rr_dequeue (t);
+		t->priority = new_priority;
+		rq_push (&rqs[t->cpu->id], t);
+		return t->cpu == cpu_current ()
+			&& t->priority > thread_current ()->priority;
+	}
+	return rr_max_priority () > thread_current ()->priority;
+}
+
+const struct sched_class rr_sched_class = {
+	.name = "rr",
+	.init = rr_init,
+	.enqueue = rr_enqueue,
+	.dequeue = rr_dequeue,
+	.pick_next = rr_pick_next,
+	.yield = rr_yield,
+	.tick = rr_tick,
+	.prio_changed = rr_prio_changed,
+	.preempts = rr_preempts,
+};
@@ -0,0 +1,274 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator for objects of fixed type.
+
+   malloc() rounds every request up to a power of two, so an
+   object just over a power of two wastes nearly half its block,
+   and all objects of similar size share one descriptor and its
+   lock.  A kmem_cache instead holds objects of exactly one size,
+   packed into "slabs" of one page each, and has a lock of its
+   own.
+
+   Each slab begins with a header and a stack of the indexes of
+   its free objects, followed by the objects themselves.  Since
+   the free list lives in the header, a free object's contents
+   are left alone: the cache's constructor runs once for each
+   object, when its slab is allocated, and an object must be
+   returned to the cache in its constructed state so that the
+   next kmem_cache_alloc() can skip that work.
+
+   A cache keeps its slabs on three lists, by whether some, none,
+   or all of their objects are free.  Allocation takes an object
+   from a partial slab if there is one, so objects stay packed
+   into as few slabs as possible, then from an empty slab, and
+   only then allocates a new slab.  One empty slab is kept to
+   absorb allocate/free cycles at a slab boundary; the rest go
+   back to the page allocator at once.
+
+   Objects larger than SLAB_MAX_SIZE should use malloc(). */
+
+/* Largest object that a cache may hold. */
+#define SLAB_MAX_SIZE (PGSIZE / 4)
+
+/* Default object alignment. */
+#define SLAB_DEFAULT_ALIGN sizeof (void *)
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of the slab's page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in one of cache's lists. */
+	size_t free_cnt;            /* # of free objects. */
+	uint16_t free[];            /* Indexes of free objects. */
+};
+
+/* All caches, for statistics. */
+static struct list caches;
+static struct lock caches_lock;
+
+static struct slab *slab_grow (struct kmem_cache *);
+static void slab_release (struct kmem_cache *, struct slab *);
+static void *slab_obj (struct kmem_cache *, struct slab *, size_t idx);
+static struct slab *obj_to_slab (struct kmem_cache *, void *obj);
+
+/* Initializes the slab allocator. */
+void
+slab_init (void) {
+	list_init (&caches);
+	lock_init (&caches_lock);
+}
+
+/* Initializes C as a cache of SIZE-byte objects, each aligned on
+   an ALIGN-byte boundary, or on a pointer-size boundary if ALIGN
+   is 0.  If CTOR is nonnull, it is called for each object when
+   the object's slab is allocated.  NAME identifies the cache in
+   statistics. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name, size_t size,
+		size_t align, kmem_ctor *ctor) {
+	size_t n;
+
+	ASSERT (c != NULL);
+	ASSERT (size > 0);
+	if (align == 0)
+		align = SLAB_DEFAULT_ALIGN;
+	ASSERT ((align & (align - 1)) == 0);
+
+	c->name = name;
+	c->align = align;
+	c->obj_size = ROUND_UP (size, align);
+	c->ctor = ctor;
+	ASSERT (c->obj_size <= SLAB_MAX_SIZE);
+
+	/* Fit as many objects as possible after the header and its
+	   free index stack. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	for (;; n--) {
+		c->obj_ofs = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+				align);
+		if (c->obj_ofs + n * c->obj_size <= PGSIZE)
+			break;
+	}
+	c->objs_per_slab = n;
+	ASSERT (c->objs_per_slab > 0);
+
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->slab_cnt = c->active_cnt = 0;
+	c->allocs = c->frees = c->grows = c->reaps = 0;
+
+	lock_acquire (&caches_lock);
+	list_push_back (&caches, &c->elem);
+	lock_release (&caches_lock);
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (!list_empty (&c->empty)) {
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		list_push_front (&c->partial, &s->elem);
+	} else {
+		s = slab_grow (c);
+		if (s == NULL) {
+			lock_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	obj = slab_obj (c, s, s->free[--s->free_cnt]);
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->active_cnt++;
+	c->allocs++;
+	lock_release (&c->lock);
+
+	return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C, to C.
+   If C has a constructor, OBJ must be in its constructed
+   state.  Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	size_t ofs;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (c, obj);
+	ofs = (uint8_t *) obj - (uint8_t *) s - c->obj_ofs;
+	ASSERT (ofs % c->obj_size == 0);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   that would undo its constructor. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	ASSERT (s->free_cnt < c->objs_per_slab);
+	if (s->free_cnt++ == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	s->free[s->free_cnt - 1] = ofs / c->obj_size;
+	if (s->free_cnt == c->objs_per_slab) {
+		list_remove (&s->elem);
+		if (list_empty (&c->empty))
+			list_push_front (&c->empty, &s->elem);
+		else
+			slab_release (c, s);
+	}
+	c->active_cnt--;
+	c->frees++;
+	lock_release (&c->lock);
+}
+
+/* Returns all of cache C's empty slabs to the page allocator. */
+void
+kmem_cache_shrink (struct kmem_cache *c) {
+	lock_acquire (&c->lock);
+	while (!list_empty (&c->empty))
+		slab_release (c, list_entry (list_pop_front (&c->empty),
+					struct slab, elem));
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for each cache. */
+void
+slab_print_stats (void) {
+	struct list_elem *e;
+
+	lock_acquire (&caches_lock);
+	for (e = list_begin (&caches); e != list_end (&caches);
+			e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+		printf ("Slab %s: %zu-byte objects, %zu per slab, %zu slabs, "
+				"%zu active, %lld allocs, %lld frees, %lld grows, "
+				"%lld reaps\n",
+				c->name, c->obj_size, c->objs_per_slab, c->slab_cnt,
+				c->active_cnt, c->allocs, c->frees, c->grows, c->reaps);
+	}
+	lock_release (&caches_lock);
+}
+
+/* Allocates a new slab for cache C, with all of its objects free
+   and constructed.  Returns a null pointer if memory is not
+   available. */
+static struct slab *
+slab_grow (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	size_t i;
+
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free_cnt = c->objs_per_slab;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		/* Hand out objects in address order. */
+		s->free[i] = c->objs_per_slab - 1 - i;
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (c, s, i));
+	}
+	c->slab_cnt++;
+	c->grows++;
+	return s;
+}
+
+/* Returns slab S, which has no objects allocated and is on none
+   of C's lists, to the page allocator. */
+static void
+slab_release (struct kmem_cache *c, struct slab *s) {
+	ASSERT (s->free_cnt == c->objs_per_slab);
+
+	s->magic = 0;
+	palloc_free_page (s);
+	c->slab_cnt--;
+	c->reaps++;
+}
+
+/* Returns object IDX within slab S of cache C. */
+static void *
+slab_obj (struct kmem_cache *c, struct slab *s, size_t idx) {
+	ASSERT (idx < c->objs_per_slab);
+	return (uint8_t *) s + c->obj_ofs + idx * c->obj_size;
+}
+
+/* Returns the slab that OBJ, an object of cache C, is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT (pg_ofs (obj) >= c->obj_ofs);
+	return s;
+}
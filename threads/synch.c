@@ -30,7 +30,48 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
+
+static bool sema_wait (struct semaphore *);
+static bool waiter_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static bool cond_waiter_less (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+static void wake_up (struct thread *);
+
+/* Most links of a chain of lock holders along which a waiting
+   thread donates its priority.
+   Controlled by kernel command-line option "-donate-depth=N". */
+int lock_donation_depth = 8;
+
+/* Arrival counter for wait queues.  Waiters of equal priority are
+   woken in order of arrival. */
+static uint64_t wait_seq;
+
+/* Wait queues.
+
+   Semaphores and condition variables keep their waiters in a
+   heap ordered by priority, highest first, and then by order of
+   arrival, so waking the highest-priority waiter costs O(log N)
+   instead of a scan of every waiter.
+
+   The order depends on each waiter's priority, which may change
+   while it waits, for example when it receives a priority
+   donation.  Whoever changes the priority of any thread must
+   then call synch_priority_changed(), which moves the thread to
+   its new place in the one wait queue that it is registered in,
+   if any, also in O(log N).  This holds whether or not the thread
+   is blocked: cond_wait() registers the running thread in the
+   condition variable's queue before it releases the lock, so it
+   is registered while still running or ready.  A thread is
+   registered in at most one queue, the one it waits in most
+   directly: a thread in cond_wait() is registered in the
+   condition variable's queue, not in the private semaphore that
+   it blocks on.  Whoever removes a thread from a queue also
+   unregisters it, with interrupts off, so that a registered
+   thread is always in its queue. */
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -46,7 +87,20 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, waiter_less, NULL);
+}
+
+/* Orders semaphore waiters by priority, highest first, and then
+   by order of arrival. */
+static bool
+waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, wait_elem);
+	const struct thread *b = heap_entry (b_, struct thread, wait_elem);
+
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->wait_seq < b->wait_seq;
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -59,18 +113,47 @@ sema_init (struct semaphore *sema, unsigned value) {
    sema_down function. */
 void
 sema_down (struct semaphore *sema) {
+	uint64_t start;
+	bool waited;
+
+	if (!lockstat_enabled) {
+		sema_wait (sema);
+		return;
+	}
+
+	start = rdtsc ();
+	waited = sema_wait (sema);
+	lockstat_record (sema, __builtin_return_address (0), false, waited,
+			rdtsc () - start);
+}
+
+/* Does the work of sema_down() and returns true if it had to
+   block. */
+static bool
+sema_wait (struct semaphore *sema) {
 	enum intr_level old_level;
+	bool waited = false;
 
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
-		list_push_back (&sema->waiters, &thread_current ()->elem);
+		struct thread *curr = thread_current ();
+
+		curr->wait_seq = wait_seq++;
+		heap_push (&sema->waiters, &curr->wait_elem);
+		if (curr->wait_queue == NULL) {
+			curr->wait_queue = &sema->waiters;
+			curr->wait_queue_elem = &curr->wait_elem;
+		}
 		thread_block ();
+		waited = true;
 	}
 	sema->value--;
 	intr_set_level (old_level);
+
+	return waited;
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -99,23 +182,56 @@ sema_try_down (struct semaphore *sema) {
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any, yielding to it if it should preempt the running
+   thread.
 
    This function may be called from an interrupt handler. */
 void
 sema_up (struct semaphore *sema) {
 	enum intr_level old_level;
+	struct thread *t = NULL;
 
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters))
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
+	if (!heap_empty (&sema->waiters)) {
+		t = heap_entry (heap_pop (&sema->waiters), struct thread, wait_elem);
+		if (t->wait_queue == &sema->waiters)
+			t->wait_queue = NULL;
+		thread_unblock (t);
+	}
 	sema->value++;
+	if (t != NULL)
+		wake_up (t);
 	intr_set_level (old_level);
 }
 
+/* Preempts the running thread in favor of T, which was just
+   unblocked, if T should run first.  Interrupts must be off. */
+static void
+wake_up (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!thread_preempts (t))
+		return;
+	if (intr_context ())
+		intr_yield_on_return ();
+	else
+		thread_yield ();
+}
+
+/* Moves T, whose priority just changed, to its new place in the
+   wait queue it is registered in, if any.  Interrupts must be
+   off. */
+void
+synch_priority_changed (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->wait_queue != NULL)
+		heap_update (t->wait_queue, t->wait_queue_elem);
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -171,25 +287,94 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->stat = NULL;
 	sema_init (&lock->semaphore, 1);
 }
 
+/* Donates the running thread's priority to HOLDER, which holds a
+   lock that the running thread is about to wait for, and onward
+   along the chain of threads that each wait for a lock held by
+   the next, for at most lock_donation_depth links.  Stops early at
+   a thread whose priority is already high enough, since every
+   thread further along then has at least that priority too.
+   Interrupts must be off. */
+static void
+donate_priority (struct thread *holder) {
+	struct thread *curr = thread_current ();
+	struct thread *t = holder;
+	int depth;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (depth = 0; t != NULL && depth < lock_donation_depth; depth++) {
+		if (t->priority >= curr->priority)
+			break;
+		thread_donate_priority (t, curr->priority);
+		t = t->waiting_lock != NULL ? t->waiting_lock->holder : NULL;
+	}
+}
+
+/* Makes the running thread the holder of LOCK, which it has just
+   taken.  It inherits the priority of the threads that still wait
+   for LOCK.  Interrupts must be off. */
+static void
+lock_taken (struct lock *lock) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	lock->holder = curr;
+	curr->waiting_lock = NULL;
+	list_push_back (&curr->held_locks, &lock->elem);
+	if (!thread_mlfqs)
+		thread_update_priority (curr);
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   While it waits, the current thread donates its priority to the
+   holder of LOCK, so that a lower-priority holder cannot keep it
+   waiting indefinitely while threads of intermediate priority
+   run.  (Not under the MLFQS, which computes priorities
+   itself.)
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
-   we need to sleep. */
+   we need to sleep.
+
+   With -lockstat, the wait is recorded against LOCK and the
+   caller's address. */
 void
 lock_acquire (struct lock *lock) {
+	enum intr_level old_level;
+	uint64_t start = 0;
+	bool waited;
+
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (!lock_held_by_current_thread (lock));
 
-	sema_down (&lock->semaphore);
-	lock->holder = thread_current ();
+	if (lockstat_enabled)
+		start = rdtsc ();
+
+	old_level = intr_disable ();
+	if (lock->holder != NULL) {
+		thread_current ()->waiting_lock = lock;
+		if (!thread_mlfqs)
+			donate_priority (lock->holder);
+	}
+	waited = sema_wait (&lock->semaphore);
+	lock_taken (lock);
+	intr_set_level (old_level);
+
+	if (lockstat_enabled) {
+		lock->acquired_at = rdtsc ();
+		lock->stat = lockstat_record (lock, __builtin_return_address (0), true,
+				waited, lock->acquired_at - start);
+	}
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -200,30 +385,60 @@ lock_acquire (struct lock *lock) {
    interrupt handler. */
 bool
 lock_try_acquire (struct lock *lock) {
+	enum intr_level old_level;
 	bool success;
 
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+		lock_taken (lock);
+	intr_set_level (old_level);
+
+	if (success && lockstat_enabled) {
+		lock->acquired_at = rdtsc ();
+		lock->stat = lockstat_record (lock, __builtin_return_address (0),
+				true, false, 0);
+	}
 	return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
    This is lock_release function.
 
+   The current thread gives up the priority it inherited through
+   LOCK.  Its new priority depends only on its own priority and the
+   highest-priority waiter of each lock it still holds, which is at
+   the top of that lock's wait queue.  If a ready thread now
+   outranks it, it yields.
+
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void
 lock_release (struct lock *lock) {
+	enum intr_level old_level;
+	bool yield = false;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
+	old_level = intr_disable ();
+	if (lock->stat != NULL) {
+		lock->stat->hold_total += rdtsc () - lock->acquired_at;
+		lock->stat = NULL;
+	}
+	list_remove (&lock->elem);
 	lock->holder = NULL;
+	if (!thread_mlfqs)
+		yield = thread_update_priority (thread_current ());
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
+
+	if (yield && !intr_context ())
+		thread_yield ();
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -236,12 +451,29 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's wait queue. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct heap_elem elem;              /* Wait queue element. */
+	struct thread *thread;              /* Waiting thread. */
+	uint64_t seq;                       /* Arrival order. */
 	struct semaphore semaphore;         /* This semaphore. */
 };
 
+/* Orders condition variable waiters by priority, highest first,
+   and then by order of arrival. */
+static bool
+cond_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct semaphore_elem *a =
+		heap_entry (a_, struct semaphore_elem, elem);
+	const struct semaphore_elem *b =
+		heap_entry (b_, struct semaphore_elem, elem);
+
+	if (a->thread->priority != b->thread->priority)
+		return a->thread->priority > b->thread->priority;
+	return a->seq < b->seq;
+}
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -249,7 +481,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	heap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -275,6 +507,7 @@ cond_init (struct condition *cond) {
 void
 cond_wait (struct condition *cond, struct lock *lock) {
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -282,14 +515,24 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	list_push_back (&cond->waiters, &waiter.elem);
+	waiter.thread = thread_current ();
+
+	old_level = intr_disable ();
+	waiter.seq = wait_seq++;
+	heap_push (&cond->waiters, &waiter.elem);
+	ASSERT (waiter.thread->wait_queue == NULL);
+	waiter.thread->wait_queue = &cond->waiters;
+	waiter.thread->wait_queue_elem = &waiter.elem;
+	intr_set_level (old_level);
+
 	lock_release (lock);
-	sema_down (&waiter.semaphore);
+	sema_wait (&waiter.semaphore);
 	lock_acquire (lock);
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
+   this function signals the highest-priority one to wake up from
+   its wait.
    LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -297,14 +540,21 @@ cond_wait (struct condition *cond, struct lock *lock) {
    interrupt handler. */
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters))
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	old_level = intr_disable ();
+	if (!heap_empty (&cond->waiters)) {
+		struct semaphore_elem *waiter = heap_entry (heap_pop (&cond->waiters),
+				struct semaphore_elem, elem);
+		waiter->thread->wait_queue = NULL;
+		sema_up (&waiter->semaphore);
+	}
+	intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -318,6 +568,228 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!heap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
+
+/* Initializes RW.  A reader-writer lock may be held by any number
+   of readers at once, or by a single writer.
+
+   Waiting writers take precedence over new readers: once a writer
+   is waiting, readers that arrive queue up behind it, so a steady
+   stream of readers cannot starve writers.  Ownership is handed
+   directly to the threads that are woken, so a woken thread
+   never has to recheck and wait again.  Like locks, reader-writer
+   locks are not recursive.
+
+   Waiters block in wait queues ordered by priority, like those of
+   semaphores, and a thread that waits while a writer holds RW
+   donates its priority to the writer as it would to the holder of
+   a lock.  Readers are only counted, so a thread that waits for
+   readers to finish donates nothing. */
+void
+rwlock_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->readers = 0;
+	rw->writer = NULL;
+	heap_init (&rw->read_waiters, waiter_less, NULL);
+	heap_init (&rw->write_waiters, waiter_less, NULL);
+}
+
+/* Blocks the running thread in wait queue WAITERS, registered in
+   it, until it is handed what it waits for and woken.  Donates
+   its priority to HOLDER first, if HOLDER is nonnull.  Interrupts
+   must be off. */
+static void
+rwlock_wait (struct heap *waiters, struct thread *holder) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (curr->wait_queue == NULL);
+
+	if (holder != NULL && !thread_mlfqs)
+		donate_priority (holder);
+	curr->wait_seq = wait_seq++;
+	heap_push (waiters, &curr->wait_elem);
+	curr->wait_queue = waiters;
+	curr->wait_queue_elem = &curr->wait_elem;
+	thread_block ();
+}
+
+/* Removes the highest-priority thread from wait queue WAITERS,
+   unblocks it, and returns it.  Interrupts must be off. */
+static struct thread *
+rwlock_wake (struct heap *waiters) {
+	struct thread *t = heap_entry (heap_pop (waiters), struct thread,
+			wait_elem);
+
+	t->wait_queue = NULL;
+	thread_unblock (t);
+	return t;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   is waiting for it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_read_acquire (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	if (rw->writer != NULL || !heap_empty (&rw->write_waiters)) {
+		/* rwlock_write_release() counts us in before waking us. */
+		rwlock_wait (&rw->read_waiters, rw->writer);
+	} else
+		rw->readers++;
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for reading.  The
+   last reader out hands RW to the highest-priority waiting
+   writer, if any, and yields to it if it should preempt the
+   running thread. */
+void
+rwlock_read_release (struct rwlock *rw) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+
+	old_level = intr_disable ();
+	ASSERT (rw->readers > 0);
+	if (--rw->readers == 0 && !heap_empty (&rw->write_waiters)) {
+		rw->writer = rwlock_wake (&rw->write_waiters);
+		wake_up (rw->writer);
+	}
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  Like lock_acquire(), the writer then inherits the priority
+   of the threads still waiting for RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_write_acquire (struct rwlock *rw) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != curr);
+
+	old_level = intr_disable ();
+	if (rw->writer != NULL || rw->readers > 0) {
+		/* The releasing thread makes us the writer before waking
+		   us. */
+		rwlock_wait (&rw->write_waiters, rw->writer);
+	} else
+		rw->writer = curr;
+	ASSERT (rw->writer == curr);
+	list_push_back (&curr->held_rwlocks, &rw->elem);
+	if (!thread_mlfqs)
+		thread_update_priority (curr);
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing, and
+   gives up the priority donated through it.  RW goes to the
+   highest-priority waiting writer if there is one, and otherwise
+   to all the waiting readers.  Yields if a woken thread, or any
+   other ready thread, now outranks the current thread. */
+void
+rwlock_write_release (struct rwlock *rw) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+	bool yield = false;
+
+	ASSERT (rw != NULL);
+	ASSERT (rw->writer == thread_current ());
+
+	old_level = intr_disable ();
+	list_remove (&rw->elem);
+	rw->writer = NULL;
+	if (!thread_mlfqs)
+		yield = thread_update_priority (thread_current ());
+	if (!heap_empty (&rw->write_waiters))
+		t = rw->writer = rwlock_wake (&rw->write_waiters);
+	else if (!heap_empty (&rw->read_waiters)) {
+		/* The first reader woken has the highest priority. */
+		t = heap_entry (heap_top (&rw->read_waiters), struct thread,
+				wait_elem);
+		while (!heap_empty (&rw->read_waiters)) {
+			rw->readers++;
+			rwlock_wake (&rw->read_waiters);
+		}
+	}
+	if (t != NULL)
+		wake_up (t);
+	intr_set_level (old_level);
+
+	if (yield && !intr_context ())
+		thread_yield ();
+}
+
+/* Initializes SL.  A sequence lock protects a small record that is
+   read far more often than it is written.  Readers take no lock
+   and never block the writer: they read the record between
+   seqlock_read_begin() and seqlock_read_retry(), and read it again
+   if a write overlapped:
+
+	   do {
+		   seq = seqlock_read_begin (&sl);
+		   copy = record;
+	   } while (seqlock_read_retry (&sl, seq));
+
+   Writers must exclude each other by other means, for example by
+   writing only from an interrupt handler.  The sequence number is
+   odd while a write is in progress.  A reader spins while it is,
+   so a reader must never interrupt a writer. */
+void
+seqlock_init (struct seqlock *sl) {
+	ASSERT (sl != NULL);
+
+	sl->seq = 0;
+}
+
+/* Starts a write to the record that SL protects. */
+void
+seqlock_write_begin (struct seqlock *sl) {
+	sl->seq++;
+	barrier ();
+}
+
+/* Finishes a write to the record that SL protects. */
+void
+seqlock_write_end (struct seqlock *sl) {
+	barrier ();
+	sl->seq++;
+}
+
+/* Starts a read of the record that SL protects, waiting for any
+   write in progress to finish.  Returns the sequence number to
+   pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *sl) {
+	unsigned seq;
+
+	while ((seq = *(volatile const unsigned *) &sl->seq) & 1)
+		barrier ();
+	barrier ();
+	return seq;
+}
+
+/* Returns true if the record that SL protects was written since
+   the call to seqlock_read_begin() that returned START, in which
+   case the reader must read it again. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned start) {
+	barrier ();
+	return *(volatile const unsigned *) &sl->seq != start;
+}
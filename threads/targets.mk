@@ -1,9 +1,20 @@
 threads_SRC  = threads/init.c		# Main program.
 threads_SRC += threads/thread.c		# Thread management core.
+threads_SRC += threads/cpu.c		# CPU enumeration.
+threads_SRC += threads/sched-deadline.c	# Deadline scheduler class.
+threads_SRC += threads/sched-rr.c	# Round-robin scheduler class.
+threads_SRC += threads/sched-mlfqs.c	# MLFQS scheduler class.
+threads_SRC += threads/sched-fair.c	# Fair-share scheduler class.
 threads_SRC += threads/interrupt.c	# Interrupt core.
+threads_SRC += threads/apic.c		# Local and I/O APICs.
+threads_SRC += threads/workqueue.c	# Deferred work.
 threads_SRC += threads/intr-stubs.S	# Interrupt stubs.
+threads_SRC += threads/switch.S		# Thread switch routine.
 threads_SRC += threads/synch.c		# Synchronization.
+threads_SRC += threads/lockstat.c	# Lock contention statistics.
 threads_SRC += threads/palloc.c		# Page allocator.
 threads_SRC += threads/malloc.c		# Subpage allocator.
+threads_SRC += threads/slab.c		# Object caches.
+threads_SRC += threads/vmalloc.c	# Virtually contiguous allocator.
 threads_SRC += threads/start.S		# Startup code.
 threads_SRC += threads/mmu.c		    # Memory management unit related things.
@@ -4,12 +4,16 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/sched.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -24,12 +28,23 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Offset of `stack' member within `struct thread'.
+   Used by switch.S, which can't figure it out on its own. */
+uint64_t thread_stack_ofs = offsetof (struct thread, stack);
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Scheduler classes, highest first, followed by a null pointer.
+   Each class owns a run queue of processes in THREAD_READY
+   state, that is, processes that are ready to run but not
+   actually running.  See threads/sched.h. */
+#define SCHED_CLASS_CNT 2
+static const struct sched_class *sched_classes[SCHED_CLASS_CNT + 1];
+
+/* Scheduler class of new threads, chosen by thread_init(). */
+const struct sched_class *base_class;
+
+/* List of all live threads.  Threads are added when they are
+   first created and removed when they exit. */
+static struct list all_list;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -40,28 +55,46 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
+/* Pages of dead threads, kept for reuse by thread_create() so that
+   creating a thread usually costs neither a trip through the page
+   allocator nor zeroing a page.  Only the struct thread at the
+   bottom of the page needs to be reinitialized, which
+   init_thread() does anyway.  Holds at most THREAD_CACHE_MAX
+   pages; the rest go back to the page allocator. */
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;
+static size_t thread_cache_cnt;
 
-/* Scheduling. */
-#define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+/* Statistics of threads that have exited. */
+static struct thread_stats exited_stats;
+
+/* Statistics. */
+static long long thread_cache_hits;     /* # of pages reused. */
+static long long thread_cache_misses;   /* # of pages allocated. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the fair-share scheduler instead.
+   Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
+static void idle_loop (void) NO_RETURN;
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static void stats_add (struct thread_stats *, const struct thread_stats *);
+static void print_thread_stats (struct thread *, void *aux);
+static void account_switch (struct thread *curr, struct thread *next);
+static struct thread *thread_page_alloc (void);
+static void thread_page_free (struct thread *);
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -107,13 +140,26 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	if (thread_mlfqs)
+		base_class = &mlfqs_sched_class;
+	else if (thread_cfs)
+		base_class = &fair_sched_class;
+	else
+		base_class = &rr_sched_class;
+	sched_classes[0] = &dl_sched_class;
+	sched_classes[1] = base_class;
+	for (int i = 0; i < SCHED_CLASS_CNT; i++)
+		sched_classes[i]->init ();
+	list_init (&all_list);
 	list_init (&destruction_req);
+	list_init (&thread_cache);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
+	initial_thread->cpu = &cpus[0];
+	cpus[0].curr = initial_thread;
 	initial_thread->tid = allocate_tid ();
 }
 
@@ -133,32 +179,104 @@ thread_start (void) {
 	sema_down (&idle_started);
 }
 
+/* Creates the idle thread of AP C, whose stack the AP starts up
+   on, and which is its running thread from then on until it
+   first schedules.  Called on the BSP, so that the AP need not
+   allocate memory as it starts.  Returns the new thread, or a
+   null pointer if memory runs out. */
+struct thread *
+thread_create_idle (struct cpu *c) {
+	struct thread *t;
+	char name[16];
+
+	t = thread_page_alloc ();
+	if (t == NULL)
+		return NULL;
+
+	snprintf (name, sizeof name, "idle%d", c->id);
+	init_thread (t, name, PRI_MIN);
+	t->tid = allocate_tid ();
+	t->status = THREAD_RUNNING;
+	t->cpu = c;
+	c->idle = c->curr = t;
+	return t;
+}
+
+/* Makes the running AP, which is running its idle thread with
+   interrupts off, start running threads from the run queues. */
+void
+thread_start_ap (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (thread_current () == cpu_current ()->idle);
+
+	idle_loop ();
+}
+
 /* Called by the timer interrupt handler at each timer tick.
    Thus, this function runs in an external interrupt context. */
 void
 thread_tick (void) {
 	struct thread *t = thread_current ();
+	struct cpu *c = cpu_current ();
 
 	/* Update statistics. */
 	if (t == idle_thread)
-		idle_ticks++;
+		c->idle_ticks++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
-		user_ticks++;
+		c->user_ticks++;
 #endif
 	else
-		kernel_ticks++;
+		c->kernel_ticks++;
+	if (t != idle_thread)
+		t->stats.run_ticks++;
+
+	for (int i = 0; i < SCHED_CLASS_CNT; i++)
+		if (sched_classes[i]->clock != NULL)
+			sched_classes[i]->clock (t);
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (t->sched_class->tick (t, ++c->thread_ticks))
 		intr_yield_on_return ();
 }
 
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
+	long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+	struct thread_stats total;
+	enum intr_level old_level;
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		idle_ticks += cpus[i].idle_ticks;
+		kernel_ticks += cpus[i].kernel_ticks;
+		user_ticks += cpus[i].user_ticks;
+	}
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	printf ("Thread pages: %lld reused, %lld allocated\n",
+			thread_cache_hits, thread_cache_misses);
+
+	/* Per-thread statistics, then totals over all threads, live
+	   or exited. */
+	total = exited_stats;
+	printf ("Live threads:\n");
+	old_level = intr_disable ();
+	thread_foreach (print_thread_stats, &total);
+	intr_set_level (old_level);
+	printf ("All threads: %lld run ticks, %lld ready ticks, "
+			"%lld voluntary, %lld involuntary switches\n",
+			total.run_ticks, total.ready_ticks,
+			total.voluntary, total.involuntary);
+	printf ("Wakeup latency (cycles):");
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		if (total.latency[i] != 0)
+			printf (" %llu+: %lld", 1ull << i, total.latency[i]);
+	printf ("\n");
+
+	for (int i = 0; i < SCHED_CLASS_CNT; i++)
+		if (sched_classes[i]->print_stats != NULL)
+			sched_classes[i]->print_stats ();
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -173,19 +291,22 @@ thread_print_stats (void) {
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread should run before the running thread, as
+   decided by thread_preempts(), the running thread yields to it
+   immediately. */
 tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
 	struct thread *t;
+	struct switch_threads_frame *sf;
+	enum intr_level old_level;
+	bool preempt;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_alloc ();
 	if (t == NULL)
 		return TID_ERROR;
 
@@ -193,19 +314,33 @@ thread_create (const char *name, int priority,
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
 
-	/* Call the kernel_thread if it scheduled.
-	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
-	t->tf.rip = (uintptr_t) kernel_thread;
-	t->tf.R.rdi = (uint64_t) function;
-	t->tf.R.rsi = (uint64_t) aux;
-	t->tf.ds = SEL_KDSEG;
-	t->tf.es = SEL_KDSEG;
-	t->tf.ss = SEL_KDSEG;
-	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
-
-	/* Add to run queue. */
+	/* Let the scheduler class set up the new thread, for example
+	   to inherit the creator's nice value.  The idle thread keeps
+	   its defaults. */
+	if (t->sched_class->fork != NULL && function != idle)
+		t->sched_class->fork (t, thread_current ());
+
+	/* Stack frame for switch_threads().  The first switch to T
+	   returns to switch_entry(), which jumps to kernel_thread
+	   (FUNCTION, AUX) with the stack aligned as if it had been
+	   called. */
+	sf = (struct switch_threads_frame *)
+		((uint8_t *) t + PGSIZE - sizeof (void *)) - 1;
+	sf->rip = switch_entry;
+	sf->rbx = (uint64_t) kernel_thread;
+	sf->r12 = (uint64_t) function;
+	sf->r13 = (uint64_t) aux;
+	t->stack = (uint8_t *) sf;
+
+	/* Add to run queue.  T may run and exit as soon as interrupts
+	   are back on, so decide about preemption first. */
+	old_level = intr_disable ();
 	thread_unblock (t);
+	preempt = thread_preempts (t);
+	intr_set_level (old_level);
+
+	if (preempt)
+		thread_yield ();
 
 	return tid;
 }
@@ -240,11 +375,42 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_push_back (&ready_list, &t->elem);
+	t->sched_class->enqueue (t);
 	t->status = THREAD_READY;
+	t->ready_since = timer_ticks ();
+	t->wake_tsc = rdtsc ();
+	t->woken = true;
+	cpu_kick_idle ();
 	intr_set_level (old_level);
 }
 
+/* Returns true if ready thread T should run in place of the
+   running thread.  Every thread preempts the idle thread, and a
+   thread of a higher scheduler class preempts one of a lower
+   class.  Between threads of the same class, the class decides.
+
+   Must be called with interrupts off.  Callers in an interrupt
+   handler should follow a true return with
+   intr_yield_on_return(), others with thread_yield(). */
+bool
+thread_preempts (const struct thread *t) {
+	struct thread *curr = running_thread ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (curr == idle_thread)
+		return true;
+	if (t->sched_class != curr->sched_class) {
+		const struct sched_class **c;
+
+		for (c = sched_classes; *c != curr->sched_class; c++)
+			if (*c == t->sched_class)
+				return true;
+		return false;
+	}
+	return t->sched_class->preempts (t, curr);
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void) {
@@ -279,6 +445,8 @@ thread_tid (void) {
    returns to the caller. */
 void
 thread_exit (void) {
+	struct thread *curr = thread_current ();
+
 	ASSERT (!intr_context ());
 
 #ifdef USERPROG
@@ -288,6 +456,10 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	if (curr->sched_class->exit != NULL)
+		curr->sched_class->exit (curr);
+	list_remove (&curr->allelem);
+	stats_add (&exited_stats, &curr->stats);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -303,15 +475,116 @@ thread_yield (void) {
 
 	old_level = intr_disable ();
 	if (curr != idle_thread)
-		list_push_back (&ready_list, &curr->elem);
+		curr->sched_class->yield (curr);
+	curr->ready_since = timer_ticks ();
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Invokes FUNC on all threads, passing along AUX.
+   This function must be called with interrupts off. */
+void
+thread_foreach (thread_action_func *func, void *aux) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&all_list); e != list_end (&all_list);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, allelem);
+		func (t, aux);
+	}
+}
+
+/* Sets the current thread's base priority to NEW_PRIORITY.  Its
+   effective priority stays higher while it holds a lock that a
+   higher-priority thread waits for.  If the current thread no
+   longer has the highest priority, yields.  Ignored under the
+   MLFQS, which computes priorities itself. */
 void
 thread_set_priority (int new_priority) {
-	thread_current ()->priority = new_priority;
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+	if (thread_mlfqs)
+		return;
+
+	old_level = intr_disable ();
+	curr->base_priority = new_priority;
+	if (thread_update_priority (curr))
+		thread_yield ();
+	intr_set_level (old_level);
+}
+
+/* Sets T's effective priority to PRIORITY and moves it to its new
+   place in the run queue or wait queue it is in.  Returns true if
+   the running thread should yield as a result. */
+static bool
+set_effective_priority (struct thread *t, int priority) {
+	int old_priority = t->priority;
+
+	if (priority == old_priority)
+		return false;
+	t->priority = priority;
+	synch_priority_changed (t);
+	if (t->status == THREAD_BLOCKED)
+		return false;
+	return t->sched_class->prio_changed (t, old_priority);
+}
+
+/* Raises T's effective priority to PRIORITY, if that is higher,
+   on behalf of a thread about to wait for a lock that T holds.
+   The caller, which is about to block, does not need to know
+   whether T should now preempt it.  Interrupts must be off. */
+void
+thread_donate_priority (struct thread *t, int priority) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (priority > t->priority)
+		set_effective_priority (t, priority);
+}
+
+/* Returns the higher of PRIORITY and the priority of the first
+   thread in wait queue WAITERS. */
+static int
+waiter_priority (struct heap *waiters, int priority) {
+	if (!heap_empty (waiters)) {
+		struct thread *w = heap_entry (heap_top (waiters), struct thread,
+				wait_elem);
+		if (w->priority > priority)
+			priority = w->priority;
+	}
+	return priority;
+}
+
+/* Recomputes T's effective priority: its base priority, raised to
+   that of the highest-priority thread waiting for any lock that T
+   holds, or for any reader-writer lock that T holds for writing.
+   Wait queues are ordered by priority, so this takes one look
+   per queue, whatever the number of waiters.  Returns true if the
+   running thread should yield as a result.  Interrupts must be
+   off. */
+bool
+thread_update_priority (struct thread *t) {
+	int priority = t->base_priority;
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+			e = list_next (e)) {
+		struct lock *lock = list_entry (e, struct lock, elem);
+		priority = waiter_priority (&lock->semaphore.waiters, priority);
+	}
+	for (e = list_begin (&t->held_rwlocks); e != list_end (&t->held_rwlocks);
+			e = list_next (e)) {
+		struct rwlock *rw = list_entry (e, struct rwlock, elem);
+		priority = waiter_priority (&rw->write_waiters, priority);
+		priority = waiter_priority (&rw->read_waiters, priority);
+	}
+	return set_effective_priority (t, priority);
 }
 
 /* Returns the current thread's priority. */
@@ -320,67 +593,66 @@ thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and lets its
+   scheduler class react, which may make the thread yield.  Under
+   the MLFQS this recomputes its priority; under the fair-share
+   scheduler it changes its weight. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
-}
+thread_set_nice (int nice) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
-/* Returns the current thread's nice value. */
-int
-thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
-}
+	ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
 
-/* Returns 100 times the system load average. */
-int
-thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	old_level = intr_disable ();
+	curr->nice = nice;
+	if (curr->sched_class->nice_changed != NULL
+			&& curr->sched_class->nice_changed (curr))
+		thread_yield ();
+	intr_set_level (old_level);
 }
 
-/* Returns 100 times the current thread's recent_cpu value. */
+/* Returns the current thread's nice value. */
 int
-thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+thread_get_nice (void) {
+	return thread_current ()->nice;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
+   The idle thread is initially put on the run queue by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
+   point it records itself as its CPU's idle thread, "up"s the
+   semaphore passed
    to it to enable thread_start() to continue, and immediately
    blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   run queue.  It is returned by next_thread_to_run() as a
+   special case when the run queue is empty. */
 static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
+	cpu_current ()->idle = thread_current ();
 	sema_up (idle_started);
+	idle_loop ();
+}
 
+/* The body of each CPU's idle thread. */
+static void
+idle_loop (void) {
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
 		thread_block ();
 
-		/* Re-enable interrupts and wait for the next one.
+		/* Use the spare time to zero pages for the page allocator,
+		   a chunk at a time, checking for other work in between. */
+		if (palloc_zero_idle ())
+			continue;
 
-		   The `sti' instruction disables interrupts until the
-		   completion of the next instruction, so these two
-		   instructions are executed atomically.  This atomicity is
-		   important; otherwise, an interrupt could be handled
-		   between re-enabling interrupts and waiting for the next
-		   one to occur, wasting as much as one clock tick worth of
-		   time.
-
-		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-		   7.11.1 "HLT Instruction". */
-		asm volatile ("sti; hlt" : : : "memory");
+		/* Re-enable interrupts and wait for the next one. */
+		timer_idle_enter ();
+		intr_wait ();
 	}
 }
 
@@ -396,9 +668,11 @@ kernel_thread (thread_func *function, void *aux) {
 
 
 /* Does basic initialization of T as a blocked thread named
-   NAME. */
+   NAME and adds it to the list of all threads. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT (name != NULL);
@@ -406,22 +680,34 @@ init_thread (struct thread *t, const char *name, int priority) {
 	memset (t, 0, sizeof *t);
 	t->status = THREAD_BLOCKED;
 	strlcpy (t->name, name, sizeof t->name);
-	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
-	t->priority = priority;
+	t->priority = t->base_priority = priority;
+	list_init (&t->held_locks);
+	list_init (&t->held_rwlocks);
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = 0;
+	t->sched_class = base_class;
 	t->magic = THREAD_MAGIC;
+
+	old_level = intr_disable ();
+	list_push_back (&all_list, &t->allelem);
+	intr_set_level (old_level);
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
+   return a thread from a run queue, unless every run queue is
    empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   will be in a run queue.)  If every run queue is empty, return
+   idle_thread.  Higher scheduler classes are asked first. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	const struct sched_class **c;
+
+	for (c = sched_classes; *c != NULL; c++) {
+		struct thread *next = (*c)->pick_next ();
+		if (next != NULL)
+			return next;
+	}
+	return idle_thread;
 }
 
 /* Use iretq to launch the thread */
@@ -452,75 +738,6 @@ do_iret (struct intr_frame *tf) {
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
-
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
-
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
-static void
-thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
-	ASSERT (intr_get_level () == INTR_OFF);
-
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
-}
-
 /* Schedules a new process. At entry, interrupts must be off.
  * This function modify current thread's status to status and then
  * finds another thread to run and switches to it.
@@ -532,7 +749,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_free (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -542,15 +759,19 @@ static void
 schedule (void) {
 	struct thread *curr = running_thread ();
 	struct thread *next = next_thread_to_run ();
+	struct cpu *c = cpu_current ();
 
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
 	ASSERT (is_thread (next));
-	/* Mark us as running. */
+	/* Mark us as running, on this CPU. */
 	next->status = THREAD_RUNNING;
+	next->cpu = c;
+	c->curr = next;
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	c->thread_ticks = 0;
+	account_switch (curr, next);
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -570,12 +791,104 @@ schedule (void) {
 			list_push_back (&destruction_req, &curr->elem);
 		}
 
-		/* Before switching the thread, we first save the information
-		 * of current running. */
-		thread_launch (next);
+		/* Switch to NEXT.  We come back here when CURR is next
+		 * scheduled. */
+		switch_threads (curr, next);
 	}
 }
 
+/* Updates the statistics of CURR, which is giving up the CPU,
+   and NEXT, which is about to run in its place. */
+static void
+account_switch (struct thread *curr, struct thread *next) {
+	if (curr != next) {
+		if (curr->status == THREAD_READY)
+			curr->stats.involuntary++;
+		else
+			curr->stats.voluntary++;
+	}
+
+	if (next != idle_thread)
+		next->stats.ready_ticks += timer_ticks () - next->ready_since;
+	if (next->woken) {
+		uint64_t wait = rdtsc () - next->wake_tsc;
+		int bucket = wait != 0 ? (int) bsrq (wait) : 0;
+
+		if (bucket >= LATENCY_BUCKETS)
+			bucket = LATENCY_BUCKETS - 1;
+		next->stats.latency[bucket]++;
+		next->woken = false;
+	}
+}
+
+/* Adds the statistics in B to those in A. */
+static void
+stats_add (struct thread_stats *a, const struct thread_stats *b) {
+	a->run_ticks += b->run_ticks;
+	a->ready_ticks += b->ready_ticks;
+	a->voluntary += b->voluntary;
+	a->involuntary += b->involuntary;
+	for (int i = 0; i < LATENCY_BUCKETS; i++)
+		a->latency[i] += b->latency[i];
+}
+
+/* Prints T's scheduling statistics and adds them to *TOTAL_.
+   Helper for thread_print_stats(). */
+static void
+print_thread_stats (struct thread *t, void *total_) {
+	printf ("  %s (tid %d): %lld run ticks, %lld ready ticks, "
+			"%lld voluntary, %lld involuntary switches\n",
+			t->name, t->tid, t->stats.run_ticks, t->stats.ready_ticks,
+			t->stats.voluntary, t->stats.involuntary);
+	stats_add (total_, &t->stats);
+}
+
+/* Copies the running thread's scheduling statistics into
+   *STATS. */
+void
+thread_get_stats (struct thread_stats *stats) {
+	enum intr_level old_level = intr_disable ();
+	*stats = thread_current ()->stats;
+	intr_set_level (old_level);
+}
+
+/* Returns a page for a new thread, from the cache of dead
+   threads' pages if possible, or a null pointer if memory is
+   exhausted.  The page is not zeroed. */
+static struct thread *
+thread_page_alloc (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (!list_empty (&thread_cache)) {
+		t = list_entry (list_pop_front (&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+		thread_cache_hits++;
+	}
+	intr_set_level (old_level);
+
+	if (t == NULL) {
+		t = palloc_get_page (0);
+		if (t != NULL)
+			thread_cache_misses++;
+	}
+	return t;
+}
+
+/* Puts dead thread T's page in the cache, or frees it if the
+   cache is full.  Interrupts must be off. */
+static void
+thread_page_free (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_cache_cnt < THREAD_CACHE_MAX) {
+		list_push_front (&thread_cache, &t->elem);
+		thread_cache_cnt++;
+	} else
+		palloc_free_page (t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
@@ -0,0 +1,231 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "intrinsic.h"
+
+/* Virtually contiguous kernel memory.
+
+   malloc() satisfies any request over 2 kB with physically
+   contiguous pages from palloc_get_multiple(), which can fail
+   once the kernel pool is fragmented, however much memory is
+   free.  vmalloc() instead takes pages one at a time and maps
+   them at consecutive addresses in the VMALLOC_START ...
+   VMALLOC_END range of the kernel page tables.
+
+   Each area is followed by an unmapped guard page, so that
+   running off the end of one faults instead of corrupting the
+   next.  The guard also marks where an area ends, so vfree()
+   needs no record of an area's size: it unmaps pages until it
+   reaches one that is not mapped.
+
+   Accessing vmalloc() memory costs TLB entries that the direct
+   mapping of physical memory does not, so kvmalloc() prefers
+   malloc() and uses vmalloc() only if that fails. */
+
+#define VMALLOC_PAGES ((VMALLOC_END - VMALLOC_START) / PGSIZE)
+
+static struct lock vmalloc_lock;
+static struct bitmap *vmalloc_map;     /* Reserved pages of the range. */
+
+/* Statistics. */
+static size_t area_cnt;                /* # of areas allocated. */
+static size_t mapped_cnt;              /* # of pages mapped. */
+static long long alloc_cnt;            /* # of successful vmalloc()s. */
+static long long fail_cnt;             /* # of failed vmalloc()s. */
+
+static bool is_mapped (const uint8_t *va);
+static void unmap_pages (uint8_t *va, size_t page_cnt);
+
+/* Initializes the vmalloc() range.  Must be called after the
+   kernel page tables are set up. */
+void
+vmalloc_init (void) {
+	lock_init (&vmalloc_lock);
+	vmalloc_map = bitmap_create (VMALLOC_PAGES);
+	if (vmalloc_map == NULL)
+		PANIC ("vmalloc_init: out of memory");
+}
+
+/* Obtains and returns a page-aligned block of at least SIZE
+   bytes that is contiguous in kernel virtual memory but not
+   necessarily in physical memory.  Returns a null pointer if
+   memory or address space is not available, or if SIZE is 0. */
+void *
+vmalloc (size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	size_t page_idx, i;
+	uint8_t *va;
+
+	if (size == 0 || vmalloc_map == NULL)
+		return NULL;
+
+	lock_acquire (&vmalloc_lock);
+	page_idx = bitmap_scan_and_flip (vmalloc_map, 0, page_cnt + 1, false);
+	if (page_idx == BITMAP_ERROR)
+		goto fail;
+	va = (uint8_t *) VMALLOC_START + page_idx * PGSIZE;
+
+	for (i = 0; i < page_cnt; i++) {
+		void *kpage = palloc_get_page (0);
+		uint64_t *pte;
+
+		if (kpage == NULL)
+			goto unmap;
+		pte = pml4e_walk (base_pml4, (uint64_t) va + i * PGSIZE, 1);
+		if (pte == NULL) {
+			palloc_free_page (kpage);
+			goto unmap;
+		}
+		ASSERT (!(*pte & PTE_P));
+		*pte = vtop (kpage) | PTE_P | PTE_W;
+	}
+	mapped_cnt += page_cnt;
+	area_cnt++;
+	alloc_cnt++;
+	lock_release (&vmalloc_lock);
+	return va;
+
+unmap:
+	unmap_pages (va, i);
+	bitmap_set_multiple (vmalloc_map, page_idx, page_cnt + 1, false);
+fail:
+	fail_cnt++;
+	lock_release (&vmalloc_lock);
+	return NULL;
+}
+
+/* Like vmalloc(), but zeroes the block. */
+void *
+vzalloc (size_t size) {
+	void *p = vmalloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+	return p;
+}
+
+/* Frees block P, which must have been obtained from vmalloc() or
+   vzalloc().  Does nothing if P is a null pointer. */
+void
+vfree (void *p) {
+	uint8_t *va = p;
+	size_t page_idx, page_cnt;
+
+	if (p == NULL)
+		return;
+
+	ASSERT (is_vmalloc_addr (p));
+	ASSERT (pg_ofs (p) == 0);
+
+	lock_acquire (&vmalloc_lock);
+	page_idx = (va - (uint8_t *) VMALLOC_START) / PGSIZE;
+	ASSERT (bitmap_test (vmalloc_map, page_idx));
+	ASSERT (page_idx == 0 || !is_mapped (va - PGSIZE));
+
+	for (page_cnt = 0; is_mapped (va + page_cnt * PGSIZE); page_cnt++)
+		continue;
+	ASSERT (page_cnt > 0);
+
+#ifndef NDEBUG
+	/* Clear the block to help detect use-after-free bugs. */
+	memset (va, 0xcc, page_cnt * PGSIZE);
+#endif
+
+	unmap_pages (va, page_cnt);
+	ASSERT (bitmap_all (vmalloc_map, page_idx, page_cnt + 1));
+	bitmap_set_multiple (vmalloc_map, page_idx, page_cnt + 1, false);
+	mapped_cnt -= page_cnt;
+	area_cnt--;
+	lock_release (&vmalloc_lock);
+}
+
+/* Returns true if P is in the vmalloc() range. */
+bool
+is_vmalloc_addr (const void *p) {
+	return (uint64_t) p >= VMALLOC_START && (uint64_t) p < VMALLOC_END;
+}
+
+/* Obtains and returns a block of at least SIZE bytes, from
+   malloc() if it can and from vmalloc() otherwise.  Returns a
+   null pointer if memory is not available.  Free the block with
+   kvfree(). */
+void *
+kvmalloc (size_t size) {
+	void *p = malloc (size);
+
+	if (p == NULL && size > PGSIZE / 2)
+		p = vmalloc (size);
+	return p;
+}
+
+/* Allocates and returns A times B bytes initialized to zeroes,
+   as kvmalloc() does.  Returns a null pointer if memory is not
+   available. */
+void *
+kvcalloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	/* Calculate block size and make sure it fits in size_t. */
+	size = a * b;
+	if (a != 0 && size / a != b)
+		return NULL;
+
+	p = kvmalloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+	return p;
+}
+
+/* Frees block P, which must have been obtained from kvmalloc()
+   or kvcalloc(). */
+void
+kvfree (void *p) {
+	if (is_vmalloc_addr (p))
+		vfree (p);
+	else
+		free (p);
+}
+
+/* Prints vmalloc() statistics. */
+void
+vmalloc_print_stats (void) {
+	printf ("Vmalloc: %zu areas, %zu pages mapped, %lld allocs, "
+			"%lld failures\n", area_cnt, mapped_cnt, alloc_cnt, fail_cnt);
+}
+
+/* Returns true if the page at VA is mapped. */
+static bool
+is_mapped (const uint8_t *va) {
+	uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) va, 0);
+	return pte != NULL && (*pte & PTE_P);
+}
+
+/* Unmaps the PAGE_CNT pages starting at VA and frees the pages
+   that were mapped there.  The page tables stay, for reuse.
+   Other CPUs may still have the old mappings in their TLBs, so
+   they are told to flush them before the range can be reused. */
+static void
+unmap_pages (uint8_t *va, size_t page_cnt) {
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++) {
+		uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) va + i * PGSIZE, 0);
+
+		ASSERT (pte != NULL && (*pte & PTE_P));
+		palloc_free_page (ptov (PTE_ADDR (*pte)));
+		*pte = 0;
+		invlpg ((uint64_t) va + i * PGSIZE);
+	}
+	cpu_flush_tlbs ();
+}
@@ -0,0 +1,152 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Deferred work.
+
+   An external interrupt handler runs with interrupts off, so
+   every cycle it spends delays every other device's interrupts.
+   A handler should therefore do only what must happen at once,
+   such as acknowledging the device and collecting its data, and
+   hand the rest to a work item with work_schedule().
+
+   Each priority has a queue of work items and a kernel worker
+   thread that runs them in order, with interrupts on.  The
+   WORK_HIGH worker is created at PRI_MAX and the WORK_NORMAL
+   worker at PRI_DEFAULT.  Under the default priority scheduler,
+   scheduling WORK_HIGH work from an interrupt handler therefore
+   makes its worker preempt the interrupted thread as the
+   interrupt returns.  The MLFQS computes priorities itself and
+   the fair-share scheduler ignores them, so under -mlfqs or -cfs
+   both workers are ordinary threads and run when the scheduler
+   picks them, like any other thread that wakes up.
+
+   Work functions run in a kernel thread, so they may block, but
+   not on anything that waits for later work on the same queue.
+   In particular, disk commands complete through WORK_HIGH work,
+   so WORK_HIGH work must not do disk I/O. */
+
+/* A work queue. */
+struct workqueue {
+	const char *name;           /* Worker thread name. */
+	int priority;               /* Worker thread priority. */
+	struct list items;          /* Pending work items. */
+	struct semaphore ready;     /* Number of pending items. */
+
+	/* Statistics. */
+	long long run_cnt;          /* # of items run. */
+	uint64_t delay_total;       /* Cycles from scheduling to start. */
+	uint64_t delay_max;         /* Longest such delay. */
+};
+
+static struct workqueue queues[WORK_PRIO_CNT] = {
+	[WORK_HIGH] = { .name = "kworker-high", .priority = PRI_MAX },
+	[WORK_NORMAL] = { .name = "kworker", .priority = PRI_DEFAULT },
+};
+
+static thread_func worker;
+
+/* Initializes the work queues, so that work may be scheduled.
+   The work does not run until workqueue_start(). */
+void
+workqueue_init (void) {
+	int i;
+
+	for (i = 0; i < WORK_PRIO_CNT; i++) {
+		list_init (&queues[i].items);
+		sema_init (&queues[i].ready, 0);
+	}
+}
+
+/* Starts the worker threads. */
+void
+workqueue_start (void) {
+	int i;
+
+	for (i = 0; i < WORK_PRIO_CNT; i++)
+		if (thread_create (queues[i].name, queues[i].priority, worker,
+					&queues[i]) == TID_ERROR)
+			PANIC ("could not start %s", queues[i].name);
+}
+
+/* Initializes W to call FUNC with AUX when it runs. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->pending = false;
+}
+
+/* Queues W to run in the worker thread for PRIO.  Returns false,
+   doing nothing, if W is already queued and has not started yet.
+   W may be scheduled again once it has started running.
+
+   This function may be called from an interrupt handler. */
+bool
+work_schedule (struct work *w, enum work_prio prio) {
+	struct workqueue *q = &queues[prio];
+	enum intr_level old_level;
+
+	ASSERT (prio < WORK_PRIO_CNT);
+
+	old_level = intr_disable ();
+	if (w->pending) {
+		intr_set_level (old_level);
+		return false;
+	}
+	w->pending = true;
+	w->queued_at = rdtsc ();
+	list_push_back (&q->items, &w->elem);
+	sema_up (&q->ready);
+	intr_set_level (old_level);
+
+	return true;
+}
+
+/* Worker thread for work queue Q_: runs its items, one at a
+   time, in the order they were scheduled. */
+static void
+worker (void *q_) {
+	struct workqueue *q = q_;
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *w;
+		uint64_t delay;
+
+		sema_down (&q->ready);
+
+		old_level = intr_disable ();
+		w = list_entry (list_pop_front (&q->items), struct work, elem);
+		w->pending = false;
+		delay = rdtsc () - w->queued_at;
+		q->run_cnt++;
+		q->delay_total += delay;
+		if (delay > q->delay_max)
+			q->delay_max = delay;
+		intr_set_level (old_level);
+
+		w->func (w->aux);
+	}
+}
+
+/* Prints work queue statistics. */
+void
+workqueue_print_stats (void) {
+	int i;
+
+	for (i = 0; i < WORK_PRIO_CNT; i++) {
+		struct workqueue *q = &queues[i];
+		printf ("Work queue %s: %lld items run, %llu cycles average "
+				"delay, %llu max\n", q->name, q->run_cnt,
+				q->run_cnt > 0 ? q->delay_total / q->run_cnt : 0,
+				q->delay_max);
+	}
+}
@@ -1,6 +1,8 @@
 #include "userprog/gdt.h"
 #include <debug.h>
+#include <string.h>
 #include "userprog/tss.h"
+#include "threads/cpu.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -61,7 +63,10 @@ struct segment_descriptor64 {
 	type, 1, dpl, 1, (unsigned) (lim) >> 28, 0, 1, 0, 1, \
 	(unsigned) (base) >> 24 }
 
-static struct segment_desc gdt[SEL_CNT] = {
+/* The GDT, as each CPU's copy of it starts out.  Each CPU needs
+   its own copy, since each CPU has its own TSS, and `ltr' marks
+   the TSS descriptor in the GDT busy. */
+static const struct segment_desc gdt[SEL_CNT] = {
 	[SEL_NULL >> 3] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 	[SEL_KCSEG >> 3] = SEG64 (0xa, 0x0, 0xffffffff, 0),
 	[SEL_KDSEG >> 3] = SEG64 (0x2, 0x0, 0xffffffff, 0),
@@ -72,19 +77,25 @@ static struct segment_desc gdt[SEL_CNT] = {
 	[7] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
-struct desc_ptr gdt_ds = {
-	.size = sizeof(gdt) - 1,
-	.address = (uint64_t) gdt
-};
+/* GDTs, indexed by CPU id. */
+static struct segment_desc gdts[CPU_MAX][SEL_CNT];
 
-/* Sets up a proper GDT.  The bootstrap loader's GDT didn't
-   include user-mode selectors or a TSS, but we need both now. */
+/* Sets up a proper GDT for the running CPU.  The bootstrap
+   loader's GDT didn't include user-mode selectors or a TSS, but
+   we need both now. */
 void
 gdt_init (void) {
 	/* Initialize GDT. */
+	struct segment_desc *gdt_cpu = gdts[cpu_current ()->id];
 	struct segment_descriptor64 *tss_desc =
-		(struct segment_descriptor64 *) &gdt[SEL_TSS >> 3];
+		(struct segment_descriptor64 *) &gdt_cpu[SEL_TSS >> 3];
 	struct task_state *tss = tss_get ();
+	struct desc_ptr gdt_ds = {
+		.size = sizeof gdt - 1,
+		.address = (uint64_t) gdt_cpu
+	};
+
+	memcpy (gdt_cpu, gdt, sizeof gdt);
 
 	*tss_desc = (struct segment_descriptor64) {
 		.lim_15_0 = (uint64_t) (sizeof (struct task_state)) & 0xffff,
@@ -5,11 +5,17 @@
 #include "threads/thread.h"
 #include "threads/loader.h"
 #include "userprog/gdt.h"
+#include "userprog/tss.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
+static void kill_process (void) NO_RETURN;
 
 /* System call.
  *
@@ -23,9 +29,24 @@ void syscall_handler (struct intr_frame *);
 #define MSR_STAR 0xc0000081         /* Segment selector msr */
 #define MSR_LSTAR 0xc0000082        /* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
+#define MSR_KERNEL_GS_BASE 0xc0000102 /* GS base that swapgs swaps in */
 
+/* Per-CPU data for syscall_entry, which finds the running CPU's
+ * through the GS base that `swapgs' switches to.  Its layout is
+ * known to syscall-entry.S. */
+struct syscall_cpu {
+	uint64_t rbx;               /* Saved user rbx. */
+	uint64_t r12;               /* Saved user r12. */
+	struct task_state *tss;     /* The CPU's TSS. */
+};
+
+static struct syscall_cpu syscall_cpus[CPU_MAX];
+
+/* Sets up the system call entry for the running CPU. */
 void
 syscall_init (void) {
+	struct syscall_cpu *sc = &syscall_cpus[cpu_current ()->id];
+
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -35,11 +56,105 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
+
+	sc->tss = tss_get ();
+	write_msr(MSR_KERNEL_GS_BASE, (uint64_t) sc);
+}
+
+/* Returns true if the SIZE bytes at user address UDST are mapped
+   writable in the running process. */
+static bool
+user_writable (void *udst, size_t size) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	uint8_t *p = pg_round_down (udst);
+	uint8_t *end = (uint8_t *) udst + size;
+
+	if (size == 0)
+		return true;
+	if (end < (uint8_t *) udst || !is_user_vaddr (end - 1))
+		return false;
+	for (; p < end; p += PGSIZE) {
+		uint64_t *pte = pml4e_walk (pml4, (uint64_t) p, 0);
+		if (pte == NULL || !(*pte & PTE_P) || !is_writable (pte)
+				|| !is_user_pte (pte))
+			return false;
+	}
+	return true;
+}
+
+/* Terminates the running process, which passed a bad pointer to
+   a system call.  A bad pointer is the process's bug, not the
+   kernel's, so it must never crash the kernel. */
+static void
+kill_process (void) {
+	thread_exit ();
+}
+
+/* thread_stats system call: copies the calling thread's
+   scheduling statistics into the user buffer STATS and returns
+   true.  Kills the process if STATS is not a valid, writable user
+   buffer. */
+static bool
+sys_thread_stats (struct thread_stats *stats) {
+	struct thread_stats ks;
+
+	if (!user_writable (stats, sizeof *stats))
+		kill_process ();
+	thread_get_stats (&ks);
+	*stats = ks;
+	return true;
+}
+
+/* intr_stats system call: copies the statistics for interrupt
+   vector VEC into the user buffer STATS and returns true, or
+   returns false if VEC is not a valid vector.  Kills the process
+   if STATS is not a valid, writable user buffer. */
+static bool
+sys_intr_stats (int vec, struct intr_stats *stats) {
+	struct intr_stats ks;
+
+	if (!user_writable (stats, sizeof *stats))
+		kill_process ();
+	if (vec < 0 || vec > UINT8_MAX)
+		return false;
+	intr_get_stats (vec, &ks);
+	*stats = ks;
+	return true;
+}
+
+/* clock_gettime system call: stores the time on CLOCK in the user
+   buffer TS and returns true, or returns false if CLOCK is not
+   supported.  Kills the process if TS is not a valid, writable
+   user buffer. */
+static bool
+sys_clock_gettime (clockid_t clock, struct timespec *ts) {
+	struct timespec kts;
+
+	if (!user_writable (ts, sizeof *ts))
+		kill_process ();
+	if (!timer_gettime (clock, &kts))
+		return false;
+	*ts = kts;
+	return true;
 }
 
 /* The main system call interface */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
+syscall_handler (struct intr_frame *f) {
+	switch (f->R.rax) {
+		case SYS_THREAD_STATS:
+			f->R.rax = sys_thread_stats ((struct thread_stats *) f->R.rdi);
+			return;
+		case SYS_INTR_STATS:
+			f->R.rax = sys_intr_stats (f->R.rdi,
+					(struct intr_stats *) f->R.rsi);
+			return;
+		case SYS_CLOCK_GETTIME:
+			f->R.rax = sys_clock_gettime (f->R.rdi,
+					(struct timespec *) f->R.rsi);
+			return;
+	}
+
 	// TODO: Your implementation goes here.
 	printf ("system call!\n");
 	thread_exit ();
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -43,32 +44,35 @@
  *      not in use, so we can always use that.  Thus, when the
  *      scheduler switches threads, it also changes the TSS's
  *      stack pointer to point to the new thread's kernel stack.
- *      (The call is in schedule in thread.c.) */
+ *      (The call is in schedule in thread.c.)
+ *
+ *  Each CPU runs a different thread, so each CPU has a TSS of its
+ *  own, with a descriptor in its own GDT (see gdt.c). */
 
-/* Kernel TSS. */
-struct task_state *tss;
+/* Kernel TSSes, indexed by CPU id. */
+static struct task_state *tss;
 
-/* Initializes the kernel TSS. */
+/* Initializes the kernel TSSes. */
 void
 tss_init (void) {
 	/* Our TSS is never used in a call gate or task gate, so only a
 	 * few fields of it are ever referenced, and those are the only
 	 * ones we initialize. */
+	ASSERT (CPU_MAX * sizeof *tss <= PGSIZE);
 	tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 	tss_update (thread_current ());
 }
 
-/* Returns the kernel TSS. */
+/* Returns the running CPU's kernel TSS. */
 struct task_state *
 tss_get (void) {
 	ASSERT (tss != NULL);
-	return tss;
+	return &tss[cpu_current ()->id];
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
- * of the thread stack. */
+/* Sets the ring 0 stack pointer in the running CPU's TSS to point
+ * to the end of the thread stack. */
 void
 tss_update (struct thread *next) {
-	ASSERT (tss != NULL);
-	tss->rsp0 = (uint64_t) next + PGSIZE;
+	tss_get ()->rsp0 = (uint64_t) next + PGSIZE;
 }